@@ -0,0 +1,29 @@
+#include <stdio.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void
+empty(void)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int group_size = benchGroupSize(argc, argv, 200);
+    char name[32];
+
+    for (unsigned int k = 0; k < BENCH_NUM_GROUPS; k++) {
+        scrGroup group = scrGroupCreate(NULL, NULL);
+
+        for (unsigned int j = 0; j < group_size; j++) {
+            snprintf(name, sizeof(name), "empty_%u", j);
+            scrGroupAddTest(group, name, empty, NULL);
+        }
+    }
+
+    // Every test is forked on its own so this is the cost of a test with nothing in it.
+    return benchRun("empty", NULL, BENCH_NUM_GROUPS * group_size);
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#ifdef SCR_MONKEYPATCH
+
+static pid_t
+fake_getppid(void)
+{
+    return 0;
+}
+
+static void
+patched(void)
+{
+    SCR_ASSERT_EQ(getppid(), 0);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int group_size = benchGroupSize(argc, argv, 100);
+    char name[32];
+
+    for (unsigned int k = 0; k < BENCH_NUM_GROUPS; k++) {
+        scrGroup group = scrGroupCreate(NULL, NULL);
+
+        if (!scrGroupPatchFunction(group, "getppid", NULL, fake_getppid)) {
+            return 1;
+        }
+        for (unsigned int j = 0; j < group_size; j++) {
+            snprintf(name, sizeof(name), "patched_%u", j);
+            scrGroupAddTest(group, name, patched, NULL);
+        }
+    }
+
+    return benchRun("monkeypatch", NULL, BENCH_NUM_GROUPS * group_size);
+}
+
+#else  // SCR_MONKEYPATCH
+
+int
+main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    printf("%-12s %-36s skipped since monkeypatching isn't enabled\n", "monkeypatch", BENCH_CONFIG);
+    return 0;
+}
+
+#endif
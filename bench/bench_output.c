@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#define OUTPUT_SIZE (64 * 1024)
+
+static void
+big_output(void)
+{
+    static char line[128];
+
+    if (!line[0]) {
+        memset(line, 'x', sizeof(line) - 1);
+        line[sizeof(line) - 1] = '\n';
+    }
+
+    for (size_t written = 0; written < OUTPUT_SIZE; written += sizeof(line)) {
+        fwrite(line, 1, sizeof(line), stdout);
+    }
+    fflush(stdout);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int group_size = benchGroupSize(argc, argv, 20);
+    char name[32];
+    // Otherwise, passing tests' output is never sent to the top-level process.
+    const scrOptions options = {.flags = SCR_RF_VERBOSE};
+
+    for (unsigned int k = 0; k < BENCH_NUM_GROUPS; k++) {
+        scrGroup group = scrGroupCreate(NULL, NULL);
+
+        for (unsigned int j = 0; j < group_size; j++) {
+            snprintf(name, sizeof(name), "big_output_%u", j);
+            scrGroupAddTest(group, name, big_output, NULL);
+        }
+    }
+
+    return benchRun("output", &options, BENCH_NUM_GROUPS * group_size);
+}
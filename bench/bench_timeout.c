@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#define NUM_HANGING 4
+
+static void
+quick(void)
+{
+}
+
+static void
+hang(void)
+{
+    while (1) {
+        pause();
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int group_size = benchGroupSize(argc, argv, 100);
+    char name[32];
+    scrGroup group;
+    const scrTestOptions quick_options = {.timeout = 10}, hang_options = {.timeout = 1};
+
+    // Every test has a timer to arm and disarm even though almost none of them go off.
+    for (unsigned int k = 0; k < BENCH_NUM_GROUPS; k++) {
+        group = scrGroupCreate(NULL, NULL);
+
+        for (unsigned int j = 0; j < group_size; j++) {
+            snprintf(name, sizeof(name), "quick_%u", j);
+            scrGroupAddTest(group, name, quick, &quick_options);
+        }
+    }
+
+    // The ones that do go off all expire together so that they only add a second to the run.
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetJobs(group, NUM_HANGING);
+    for (unsigned int k = 0; k < NUM_HANGING; k++) {
+        snprintf(name, sizeof(name), "hang_%u", k);
+        scrGroupAddTest(group, name, hang, &hang_options);
+    }
+
+    return benchRun("timeout", NULL, BENCH_NUM_GROUPS * group_size + NUM_HANGING);
+}
@@ -0,0 +1,86 @@
+#ifndef SCRUTINY_BENCH_COMMON_H
+#define SCRUTINY_BENCH_COMMON_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#define BENCH_NUM_GROUPS 10
+
+#ifdef DEBUG
+#define BENCH_DEBUG " debug=yes"
+#else
+#define BENCH_DEBUG ""
+#endif
+
+#ifdef SCR_NO_PIDFD
+#define BENCH_PIDFD " pidfd=no"
+#else
+#define BENCH_PIDFD ""
+#endif
+
+#ifdef SCR_MONKEYPATCH
+#define BENCH_MONKEYPATCH " monkeypatch=yes"
+#else
+#define BENCH_MONKEYPATCH ""
+#endif
+
+// The make variables that the benchmark was built with.
+#define BENCH_CONFIG "make" BENCH_DEBUG BENCH_PIDFD BENCH_MONKEYPATCH
+
+// The number of tests per group can be given as the first argument.
+static inline unsigned int
+benchGroupSize(int argc, char **argv, unsigned int default_size)
+{
+    unsigned long size;
+
+    if (argc < 2) {
+        return default_size;
+    }
+
+    size = strtoul(argv[1], NULL, 10);
+    return (size > 0) ? size : default_size;
+}
+
+// Returns 0 if all of the expected tests ran.
+static inline int
+benchRun(const char *name, const scrOptions *options, unsigned int num_expected)
+{
+    int saved_stdout, null_fd;
+    unsigned int num_run;
+    double elapsed;
+    struct timespec start, end;
+    scrStats stats;
+
+    // The run's own output would cost more to print than most of the tests cost to run.
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    if (saved_stdout < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        perror("Failed to silence the run");
+        return 1;
+    }
+    close(null_fd);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    scrRun(options, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    num_run = stats.num_passed + stats.num_failed + stats.num_errored + stats.num_skipped;
+    printf("%-12s %-36s %6u tests %8.3fs %9.0f tests/s %8.1fus overhead/test\n", name, BENCH_CONFIG, num_run,
+           elapsed, (elapsed > 0) ? num_run / elapsed : 0,
+           (num_run > 0) ? stats.overhead_time / num_run * 1e6 : 0);
+
+    return num_run != num_expected;
+}
+
+#endif  // SCRUTINY_BENCH_COMMON_H
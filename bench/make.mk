@@ -0,0 +1,26 @@
+BENCH_BINARIES := $(patsubst %.c,%,$(wildcard $(BENCH_DIR)/bench_*.c))
+
+ifeq ($(DARWIN),yes)
+BENCH_CONFIGS := "" "debug=yes"
+else
+BENCH_CONFIGS := "" "debug=yes" "pidfd=no" "monkeypatch=yes" "monkeypatch=yes pidfd=no"
+endif
+
+bench: $(BENCH_BINARIES)
+	failed=0; for binary in $(BENCH_BINARIES); do ./$$binary || failed=$$((failed+1)); done; test $$failed = 0
+
+# Each configuration needs a clean build since the flags aren't tracked by the object files.  The variables are
+# cleared first so that any given to this make don't carry over into every configuration.
+bench_all:
+	for config in $(BENCH_CONFIGS); do \
+	    $(MAKE) clean && $(MAKE) debug= pidfd= monkeypatch= $$config bench || exit 1; \
+	done
+
+$(BENCH_DIR)/bench_%: $(BENCH_DIR)/bench_%.c $(BENCH_DIR)/common.h $(SCR_SHARED_LIBRARY)
+	$(CC) $(CFLAGS) $(SCR_INCLUDE_FLAGS) $< -Wl,-rpath $(CURDIR) -L$(CURDIR) -lscrutiny -o $@
+
+bench_clean:
+	@rm -f $(BENCH_BINARIES)
+
+.PHONY: bench bench_all bench_clean
+CLEAN_TARGETS += bench_clean
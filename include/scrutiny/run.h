@@ -41,14 +41,87 @@ typedef struct scrTestOptions {
     unsigned int flags;   /**< Bitwise-or-combined flags. */
 } scrTestOptions;
 
+/**
+ * @brief The signature for a benchmark function.  It should run the code being measured the given number of
+ * times.
+ */
+typedef void
+scrBenchmarkFn(unsigned long iterations);
+
+/**
+ * @brief Options to pass to scrGroupAddBenchmark.
+ */
+typedef struct scrBenchmarkOptions {
+    unsigned int timeout;     /**< If positive, the number of seconds to timeout the benchmark. */
+    unsigned int warmups;     /**< The number of unmeasured repetitions.  If 0, then 1 will be used. */
+    unsigned int repetitions; /**< The number of measured repetitions.  If 0, then 10 will be used. */
+    double target_time;       /**< The target duration of each repetition in seconds.  If 0, then 0.1 will be
+                                 used. */
+} scrBenchmarkOptions;
+
+/**
+ * @brief How tests are isolated from each other.
+ */
+typedef enum scrIsolation {
+    SCR_ISOLATION_DEFAULT = 0, /**< For a group, use the run's isolation.  For a run, the same as
+                                  SCR_ISOLATION_TEST. */
+    SCR_ISOLATION_TEST,        /**< Each test runs in its own process. */
+    SCR_ISOLATION_BATCH,       /**< Consecutive tests share a process which is only replaced after a crash or
+                                  timeout. */
+    SCR_ISOLATION_NONE,        /**< Tests run inside of the group runner without forking.  A crash takes down
+                                  the whole group. */
+} scrIsolation;
+
 /**
  * @brief Options to pass to scrRun.
  */
 typedef struct scrOptions {
-    void *global_ctx;   /**< The global context for the tests. */
-    unsigned int flags; /**< Bitwise-or-combined flags. */
+    void *global_ctx;      /**< The global context for the tests. */
+    unsigned int flags;    /**< Bitwise-or-combined flags. */
+    unsigned int max_jobs; /**< The maximum number of groups to run at once.  If 0, then the number of online
+                              CPUs will be used. */
+    const char *baseline_file;   /**< If not NULL, the file holding the timing baseline.  Tests which are
+                                    significantly slower than their baseline will fail. */
+    double regression_threshold; /**< The relative slowdown which counts as a regression.  If 0, then 0.1
+                                    (i.e., 10%) will be used. */
+    unsigned int pool_size;      /**< The number of idle, pre-forked test processes that each group runner
+                                    keeps ready. */
+    scrIsolation isolation;      /**< The isolation of the tests in groups which don't set their own. */
+    const char *history_file;    /**< If not NULL, the file in which the durations of groups and tests are
+                                    kept.  They're used to start the longest ones first and to estimate the
+                                    remaining time. */
+    unsigned int shard_index;    /**< Which of the shards this process runs, counting from 0. */
+    unsigned int shard_count;    /**< If greater than 1, the number of shards the tests are split into.  If
+                                    0, the SCRUTINY_SHARD_INDEX and SCRUTINY_SHARD_COUNT environment variables
+                                    are used instead. */
+    const char *const *include_filters; /**< If not NULL, a NULL-terminated array of patterns.  Only tests
+                                           whose names match at least one of them are run. */
+    const char *const *exclude_filters; /**< If not NULL, a NULL-terminated array of patterns.  Tests whose
+                                           names match any of them aren't run. */
+    const char *journal_file; /**< If not NULL, the file in which each test's latest result and duration are
+                                 kept.  Required by SCR_RF_FAILED_FIRST, SCR_RF_FAILED_ONLY, and
+                                 SCR_RF_FAILED_GATE. */
+    const char *cache_file;   /**< If not NULL, the file in which passing tests are remembered (Linux only).
+                                 Tests which passed with an identical binary and libraries are reported as
+                                 cached instead of being run. */
+    const char *junit_file;   /**< If not NULL, the file to which a JUnit XML report of the run is written. */
+    const char *jsonl_file;   /**< If not NULL, the file to which each result is written as a line of JSON. */
+    const char *trace_file;   /**< If not NULL, the file to which a Chrome trace-event timeline of the run is
+                                 written. */
 } scrOptions;
 
+/**
+ * @brief Holds the resources used by tests.
+ */
+typedef struct scrUsage {
+    double wall_time;          /**< The elapsed wall-clock time in seconds. */
+    double user_time;          /**< The CPU time spent in user mode in seconds. */
+    double system_time;        /**< The CPU time spent in kernel mode in seconds. */
+    long max_rss;              /**< The maximum resident set size in kilobytes. */
+    long voluntary_switches;   /**< The number of voluntary context switches. */
+    long involuntary_switches; /**< The number of involuntary context switches. */
+} scrUsage;
+
 /**
  * @brief Holds the test results.
  */
@@ -58,6 +131,12 @@ typedef struct scrStats {
     unsigned int num_failed;  /**< The number of tests which failed. */
     unsigned int
         num_errored; /**< The number of tests which encountered an error (i.e., some terminating signal). */
+    unsigned int num_cached;  /**< The number of passing tests which were taken from the cache. */
+    unsigned int num_group_errors; /**< The number of groups whose runners failed (e.g., in cleanup_fn) after
+                                      all of their tests had finished. */
+    scrUsage total_usage; /**< The resources used by all of the tests combined. */
+    scrUsage max_usage;   /**< The largest value of each resource used by any single test. */
+    double overhead_time; /**< How many seconds the framework spent on its own work (see SCR_RF_OVERHEAD). */
 } scrStats;
 
 /**
@@ -73,6 +152,44 @@ typedef struct scrStats {
  * @brief Displays output even when tests pass.
  */
 #define SCR_RF_VERBOSE 0x00000002
+/**
+ * @brief Streams each test's output live, prefixed by the test's name, instead of capturing it.
+ */
+#define SCR_RF_STREAM 0x00000004
+/**
+ * @brief Counts CPU cycles, instructions, cache misses, and branch misses for each test (Linux only).
+ */
+#define SCR_RF_COUNTERS 0x00000008
+/**
+ * @brief Records this run's timings in the baseline file rather than comparing against it.
+ */
+#define SCR_RF_UPDATE_BASELINE 0x00000010
+/**
+ * @brief Runs the tests which failed in the journaled run before all of the others.
+ */
+#define SCR_RF_FAILED_FIRST 0x00000020
+/**
+ * @brief Only runs the tests which failed in the journaled run.
+ */
+#define SCR_RF_FAILED_ONLY 0x00000040
+/**
+ * @brief Like SCR_RF_FAILED_FIRST but stops after the tests which failed in the journaled run unless they all
+ * pass.
+ */
+#define SCR_RF_FAILED_GATE 0x00000080
+/**
+ * @brief Runs every test even if it's cached.  The cache is still updated.
+ */
+#define SCR_RF_REFRESH_CACHE 0x00000100
+/**
+ * @brief Shows how much time the framework spent on each phase of its own work at the end of the run.
+ */
+#define SCR_RF_OVERHEAD 0x00000200
+/**
+ * @brief Applies a group's monkeypatches once in its group runner, whose forked test processes inherit them,
+ * instead of tracing each test's process.
+ */
+#define SCR_RF_PATCH_ONCE 0x00000400
 
 /**
  * @brief Creates a new test group.
@@ -99,6 +216,44 @@ void
 scrGroupAddTest(scrGroup group, const char *name, scrTestFn test_fn, const scrTestOptions *options) SCR_EXPORT
     SCR_NONNULL(2, 3);
 
+/**
+ * @brief Adds a benchmark to a group.
+ *
+ * @param group     The group handle.
+ * @param name      The name of the benchmark.
+ * @param bench_fn  The benchmark function.
+ * @param options   A pointer to the options to use.  If NULL, default options will be used.
+ *
+ * @note            The number of iterations is calibrated so that each repetition takes roughly the target
+ * time.
+ */
+void
+scrGroupAddBenchmark(scrGroup group, const char *name, scrBenchmarkFn bench_fn,
+                     const scrBenchmarkOptions *options) SCR_EXPORT SCR_NONNULL(2, 3);
+
+/**
+ * @brief Sets how many of a group's tests can run at once.
+ *
+ * @param group     The group handle.
+ * @param max_jobs  The maximum number of concurrent tests.  If 0, then the number of online CPUs will be used.
+ *
+ * @note            By default, a group's tests are run one at a time.
+ */
+void
+scrGroupSetJobs(scrGroup group, unsigned int max_jobs) SCR_EXPORT;
+
+/**
+ * @brief Sets how a group's tests are isolated from each other.
+ *
+ * @param group     The group handle.
+ * @param isolation The isolation to use.  If SCR_ISOLATION_DEFAULT, then the run's isolation will be used.
+ *
+ * @note            Benchmarks, as well as all tests when streaming output or counting hardware events, still
+ * run in their own processes.  So do tests with timeouts when the isolation is SCR_ISOLATION_NONE.
+ */
+void
+scrGroupSetIsolation(scrGroup group, scrIsolation isolation) SCR_EXPORT;
+
 /**
  * @brief Enables monkeypatching of a function for all of a group's tests.
  *
@@ -0,0 +1,197 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "internal.h"
+
+#define BASELINE_HEADER "# scrutiny baseline 1\n"
+
+#define DEFAULT_THRESHOLD 0.1
+// How many standard errors a slowdown has to exceed before it's considered significant.
+#define SIGNIFICANCE 3.0
+// Older samples are down-weighted so that the baseline can follow deliberate changes.
+#define MAX_SAMPLES 50
+// Plain tests are timed by their wall time which is too noisy to compare below this many seconds.
+#define MIN_WALL_DIFFERENCE 0.001
+// A baseline with fewer samples than this doesn't say enough about how much the test varies.
+#define MIN_SAMPLES 3
+// A few samples can agree by chance so no timing is assumed to vary by less than this fraction of its mean.
+#define MIN_RELATIVE_STDDEV 0.05
+
+typedef struct baselineEntry {
+    scrStoreKey key;
+    scrTiming timing;
+} baselineEntry;
+
+static scrStore entries;
+static double threshold;
+static bool comparing;
+
+static bool
+parseEntry(scrStore *store, char *line, void *arg)
+{
+    baselineEntry entry;
+    int name_offset;
+    (void)arg;
+
+    if (sscanf(line, "%zu %u %lf %lf %n", &entry.key.group_idx, &entry.timing.samples, &entry.timing.mean,
+               &entry.timing.stddev, &name_offset) != 4 ||
+        entry.timing.samples == 0) {
+        return false;
+    }
+
+    entry.key.name = line + name_offset;
+    return storeAdd(store, &entry) != NULL;
+}
+
+bool
+baselineLoad(const scrOptions *options)
+{
+    FILE *file;
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    if (!options->baseline_file) {
+        return true;
+    }
+
+    storeInit(&entries, sizeof(baselineEntry));
+    threshold = (options->regression_threshold > 0) ? options->regression_threshold : DEFAULT_THRESHOLD;
+    comparing = !(options->flags & SCR_RF_UPDATE_BASELINE);
+
+    file = fopen(options->baseline_file, "r");
+    if (!file) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        perror("fopen");
+        return false;
+    }
+
+    if (!storeRead(&entries, file, BASELINE_HEADER, parseEntry, NULL)) {
+        fprintf(stderr, "Malformed baseline file: %s\n", options->baseline_file);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            baselineEntry *entry = storeFind(&entries, group_idx, test->name);
+
+            test->baseline = entry ? &entry->timing : NULL;
+        }
+    }
+
+    return true;
+}
+
+bool
+baselineRegressed(const scrTest *test, const scrTiming *timing)
+{
+    const scrTiming *base = test->baseline;
+    double difference, base_stddev, stddev, error;
+
+    if (!comparing || !base || base->samples < MIN_SAMPLES) {
+        return false;
+    }
+
+    difference = timing->mean - base->mean;
+    if (difference <= base->mean * threshold || (!test->bench_fn && difference < MIN_WALL_DIFFERENCE)) {
+        return false;
+    }
+
+    base_stddev = fmax(base->stddev, MIN_RELATIVE_STDDEV * base->mean);
+    // A single sample has no spread of its own so assume that it varies as much as the baseline does.
+    stddev = (timing->samples > 1) ? fmax(timing->stddev, MIN_RELATIVE_STDDEV * timing->mean) : base_stddev;
+    error = sqrt(base_stddev * base_stddev / base->samples + stddev * stddev / timing->samples);
+    return difference > SIGNIFICANCE * error;
+}
+
+static void
+mergeTiming(scrTiming *base, const scrTiming *timing)
+{
+    unsigned int samples = base->samples + timing->samples;
+    double delta = timing->mean - base->mean, m2;
+
+    m2 = base->stddev * base->stddev * (base->samples - 1) +
+         timing->stddev * timing->stddev * (timing->samples - 1) +
+         delta * delta * base->samples * timing->samples / samples;
+
+    base->mean += delta * timing->samples / samples;
+    base->stddev = sqrt(m2 / (samples - 1));
+    base->samples = (samples > MAX_SAMPLES) ? MAX_SAMPLES : samples;
+}
+
+static bool
+updateEntries(void)
+{
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            baselineEntry *entry;
+
+            if (!test->record || !test->record->finished || test->record->result != SCR_TEST_CODE_OK) {
+                continue;
+            }
+
+            entry = storeFind(&entries, group_idx, test->name);
+            if (entry) {
+                mergeTiming(&entry->timing, &test->record->timing);
+            }
+            else {
+                baselineEntry new_entry = {.key = {group_idx, test->name}, .timing = test->record->timing};
+
+                if (!storeAdd(&entries, &new_entry)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static void
+writeEntries(FILE *file)
+{
+    baselineEntry *entry;
+
+    fputs(BASELINE_HEADER, file);
+    GEAR_FOR_EACH(&entries.entries, entry)
+    {
+        fprintf(file, "%zu %u %.9g %.9g %s\n", entry->key.group_idx, entry->timing.samples,
+                entry->timing.mean, entry->timing.stddev, entry->key.name);
+    }
+}
+
+void
+baselineSave(const scrOptions *options)
+{
+    if (!options->baseline_file || !(options->flags & SCR_RF_UPDATE_BASELINE)) {
+        return;
+    }
+
+    if (!updateEntries()) {
+        fprintf(stderr, "Failed to update the baseline\n");
+        return;
+    }
+
+    storeWrite(options->baseline_file, "baseline", writeEntries);
+}
+
+void
+baselineFree(void)
+{
+    storeFree(&entries);
+}
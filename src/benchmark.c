@@ -0,0 +1,142 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "internal.h"
+
+#define DEFAULT_WARMUPS     1
+#define DEFAULT_REPETITIONS 10
+#define DEFAULT_TARGET_TIME 0.1
+
+// Calibration never grows the iteration count by more than this factor at once.
+#define MAX_SCALE 100.0
+
+static double
+timeRepetition(scrBenchmarkFn *bench_fn, unsigned long iterations)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bench_fn(iterations);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static unsigned long
+calibrate(scrBenchmarkFn *bench_fn, double target_time)
+{
+    unsigned long iterations = 1;
+
+    while (1) {
+        double elapsed, scale;
+
+        elapsed = timeRepetition(bench_fn, iterations);
+        if (elapsed >= target_time) {
+            return iterations;
+        }
+
+        // Aim a little past the target so that we don't creep up on it one small step at a time.
+        scale = (elapsed > 0) ? 1.2 * target_time / elapsed : MAX_SCALE;
+        if (scale > MAX_SCALE) {
+            scale = MAX_SCALE;
+        }
+        else if (scale < 2) {
+            scale = 2;
+        }
+
+        if (iterations > (unsigned long)(ULONG_MAX / scale)) {
+            return iterations;
+        }
+        iterations *= scale;
+    }
+}
+
+static int
+compareDoubles(const void *item1, const void *item2)
+{
+    double a = *(const double *)item1, b = *(const double *)item2;
+
+    return (a > b) - (a < b);
+}
+
+void
+benchmarkDo(const scrTest *test, scrBenchmarkResult *result)
+{
+    const scrBenchmarkOptions *options = &test->bench_options;
+    unsigned int warmups = options->warmups ? options->warmups : DEFAULT_WARMUPS,
+                 repetitions = options->repetitions ? options->repetitions : DEFAULT_REPETITIONS;
+    double target_time = (options->target_time > 0) ? options->target_time : DEFAULT_TARGET_TIME, sum = 0,
+           sum_squares = 0;
+    unsigned long iterations;
+    double *times;
+
+    times = malloc(sizeof(*times) * repetitions);
+    if (!times) {
+        SCR_FAIL("malloc failed");
+    }
+
+    iterations = calibrate(test->bench_fn, target_time);
+
+    for (unsigned int k = 0; k < warmups; k++) {
+        timeRepetition(test->bench_fn, iterations);
+    }
+
+    for (unsigned int k = 0; k < repetitions; k++) {
+        times[k] = timeRepetition(test->bench_fn, iterations) / iterations;
+        sum += times[k];
+    }
+
+    qsort(times, repetitions, sizeof(*times), compareDoubles);
+
+    result->repetitions = repetitions;
+    result->iterations = iterations;
+    result->min = times[0];
+    result->median = (repetitions % 2) ? times[repetitions / 2]
+                                       : (times[repetitions / 2 - 1] + times[repetitions / 2]) / 2;
+    result->mean = sum / repetitions;
+    for (unsigned int k = 0; k < repetitions; k++) {
+        double diff = times[k] - result->mean;
+
+        sum_squares += diff * diff;
+    }
+    result->stddev = (repetitions > 1) ? sqrt(sum_squares / (repetitions - 1)) : 0;
+    result->valid = true;
+
+    free(times);
+}
+
+static void
+showDuration(const char *label, double seconds)
+{
+    static const char *const units[] = {"ns", "us", "ms"};
+    double value = seconds * 1e9;
+    unsigned int idx;
+
+    for (idx = 0; idx < ARRAY_LENGTH(units) && value >= 1000; idx++) {
+        value /= 1000;
+    }
+
+    printf("%s %.3f %s", label, value, (idx < ARRAY_LENGTH(units)) ? units[idx] : "s");
+}
+
+void
+showBenchmarkResult(const scrTest *test, const scrBenchmarkResult *result)
+{
+    static const char *const prefixes[] = {"", "k", "M", "G"};
+    double ops = (result->mean > 0) ? 1 / result->mean : 0;
+    unsigned int idx;
+
+    for (idx = 0; idx + 1 < ARRAY_LENGTH(prefixes) && ops >= 1000; idx++) {
+        ops /= 1000;
+    }
+
+    printf("Benchmark (%s): %u x %lu iterations: ", test->name, result->repetitions, result->iterations);
+    showDuration("min", result->min);
+    showDuration(", median", result->median);
+    showDuration(", mean", result->mean);
+    showDuration(", stddev", result->stddev);
+    printf(", %.2f%s ops/s\n", ops, prefixes[idx]);
+}
@@ -0,0 +1,236 @@
+#ifdef __linux__
+// For dl_iterate_phdr.
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define CACHE_HEADER "# scrutiny cache 1\n"
+
+typedef enum cacheBinary {
+    CACHE_BINARY_UNKNOWN,
+    CACHE_BINARY_SAME,
+    CACHE_BINARY_OTHER,
+} cacheBinary;
+
+static scrStore entries;
+static uint64_t binary_hash;
+static bool loaded;
+
+#ifdef __linux__
+
+#include <link.h>
+
+static void
+hashFile(const char *path, uint64_t *hash)
+{
+    int fd;
+    struct stat info;
+    const unsigned char *contents;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        // Objects like the vDSO don't exist as files and can't change without the kernel changing.
+        return;
+    }
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return;
+    }
+    contents = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (contents == MAP_FAILED) {
+        return;
+    }
+
+    *hash = hashBytes(*hash, contents, info.st_size);
+    munmap((void *)contents, info.st_size);
+}
+
+static int
+hashObject(struct dl_phdr_info *info, size_t size, void *data)
+{
+    (void)size;
+
+    // The main program is the only object without a name.
+    hashFile(info->dlpi_name[0] ? info->dlpi_name : "/proc/self/exe", data);
+    return 0;
+}
+
+static bool
+hashBinary(void)
+{
+    binary_hash = FNV_OFFSET_BASIS;
+    dl_iterate_phdr(hashObject, &binary_hash);
+    return true;
+}
+
+#else  // __linux__
+
+static bool
+hashBinary(void)
+{
+    fprintf(stderr, "The result cache is only supported on Linux.\n");
+    return false;
+}
+
+#endif  // __linux__
+
+// The first line after the header is the hash of the binary.  Entries from a different binary are silently
+// dropped.
+static bool
+parseEntry(scrStore *store, char *line, void *arg)
+{
+    cacheBinary *binary = arg;
+    scrStoreKey entry;
+    uint64_t hash;
+    int name_offset;
+
+    if (*binary == CACHE_BINARY_UNKNOWN) {
+        if (sscanf(line, "binary %" SCNx64, &hash) != 1) {
+            return false;
+        }
+        *binary = (hash == binary_hash) ? CACHE_BINARY_SAME : CACHE_BINARY_OTHER;
+        return true;
+    }
+    if (*binary == CACHE_BINARY_OTHER) {
+        return true;
+    }
+
+    if (sscanf(line, "%zu %n", &entry.group_idx, &name_offset) != 1) {
+        return false;
+    }
+
+    entry.name = line + name_offset;
+    return storeAdd(store, &entry) != NULL;
+}
+
+void
+cacheLoad(const scrOptions *options)
+{
+    FILE *file;
+    scrGroupStruct *group;
+    size_t group_idx;
+    cacheBinary binary = CACHE_BINARY_UNKNOWN;
+
+    loaded = false;
+    if (!options->cache_file || !hashBinary()) {
+        return;
+    }
+
+    storeInit(&entries, sizeof(scrStoreKey));
+
+    file = fopen(options->cache_file, "r");
+    if (file) {
+        if (!storeRead(&entries, file, CACHE_HEADER, parseEntry, &binary) || binary == CACHE_BINARY_UNKNOWN) {
+            fprintf(stderr, "Ignoring malformed cache file: %s\n", options->cache_file);
+            cacheFree();
+            storeInit(&entries, sizeof(scrStoreKey));
+        }
+        fclose(file);
+    }
+    else if (errno != ENOENT) {
+        perror("fopen");
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            test->cached = !test->bench_fn && storeFind(&entries, group_idx, test->name);
+        }
+    }
+
+    loaded = true;
+}
+
+void
+cacheSkip(const scrOptions *options, scrStats *stats)
+{
+    scrGroupStruct *group;
+
+    if (!loaded || (options->flags & SCR_RF_REFRESH_CACHE)) {
+        return;
+    }
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            if (test->selected && test->cached) {
+                scrReportEntry entry = {.test = test, .group_idx = group->idx, .cached = true};
+
+                test->selected = false;
+                group->num_selected--;
+                stats->num_passed++;
+                stats->num_cached++;
+                showCachedResult(test);
+                reportersAdd(&entry);
+            }
+        }
+    }
+}
+
+static void
+writeEntries(FILE *file)
+{
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    fprintf(file, CACHE_HEADER "binary %016" PRIx64 "\n", binary_hash);
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            const scrTestRecord *record = test->record;
+            bool passed;
+
+            if (test->bench_fn) {
+                continue;
+            }
+
+            // Tests which didn't run this time stay cached unless their group runner gave up on them.
+            if (record && record->finished) {
+                passed = (record->result == SCR_TEST_CODE_OK);
+            }
+            else {
+                passed = test->cached && (!record || record->result == SCR_TEST_CODE_OK);
+            }
+            if (passed) {
+                fprintf(file, "%zu %s\n", group_idx, test->name);
+            }
+        }
+    }
+}
+
+void
+cacheSave(const scrOptions *options)
+{
+    if (!loaded) {
+        return;
+    }
+
+    storeWrite(options->cache_file, "cache", writeEntries);
+}
+
+void
+cacheFree(void)
+{
+    storeFree(&entries);
+}
@@ -0,0 +1,150 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+static const char *const counter_names[SCR_NUM_COUNTERS] = {
+    [SCR_COUNTER_CYCLES] = "cycles",
+    [SCR_COUNTER_INSTRUCTIONS] = "instructions",
+    [SCR_COUNTER_CACHE_MISSES] = "cache misses",
+    [SCR_COUNTER_BRANCH_MISSES] = "branch misses",
+};
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static const unsigned long long counter_configs[SCR_NUM_COUNTERS] = {
+    [SCR_COUNTER_CYCLES] = PERF_COUNT_HW_CPU_CYCLES,
+    [SCR_COUNTER_INSTRUCTIONS] = PERF_COUNT_HW_INSTRUCTIONS,
+    [SCR_COUNTER_CACHE_MISSES] = PERF_COUNT_HW_CACHE_MISSES,
+    [SCR_COUNTER_BRANCH_MISSES] = PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int
+openCounter(unsigned int idx, pid_t pid, int group_fd)
+{
+    struct perf_event_attr attr = {0};
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = counter_configs[idx];
+    attr.disabled = (group_fd < 0);
+    // Only counting user space keeps the counters usable when perf_event_paranoid is 2.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(SYS_perf_event_open, &attr, pid, -1, group_fd, 0);
+}
+
+bool
+countersProbe(void)
+{
+    int fd;
+
+    fd = openCounter(SCR_COUNTER_CYCLES, 0, -1);
+    if (fd < 0) {
+        fprintf(stderr, "Hardware counters are unavailable (%s).  Check /proc/sys/kernel/perf_event_paranoid.\n",
+                strerror(errno));
+        return false;
+    }
+
+    close(fd);
+    return true;
+}
+
+void
+countersStart(scrCounters *counters, pid_t child)
+{
+    int leader;
+
+    counters->available = 0;
+    for (unsigned int k = 0; k < SCR_NUM_COUNTERS; k++) {
+        counters->fds[k] = -1;
+    }
+
+    // The cycle counter leads the group so that all of the counters are scheduled onto the PMU together.
+    leader = counters->fds[SCR_COUNTER_CYCLES] = openCounter(SCR_COUNTER_CYCLES, child, -1);
+    if (leader < 0) {
+        return;
+    }
+
+    for (unsigned int k = 0; k < SCR_NUM_COUNTERS; k++) {
+        if (k != SCR_COUNTER_CYCLES) {
+            counters->fds[k] = openCounter(k, child, leader);
+        }
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void
+countersStop(scrCounters *counters)
+{
+    // The child has already been reaped so the counts are final.
+    for (unsigned int k = 0; k < SCR_NUM_COUNTERS; k++) {
+        if (counters->fds[k] < 0) {
+            continue;
+        }
+
+        if (read(counters->fds[k], &counters->values[k], sizeof(counters->values[k])) ==
+            (ssize_t)sizeof(counters->values[k])) {
+            counters->available |= (1 << k);
+        }
+        close(counters->fds[k]);
+        counters->fds[k] = -1;
+    }
+}
+
+#else  // __linux__
+
+bool
+countersProbe(void)
+{
+    fprintf(stderr, "Hardware counters are only supported on Linux.\n");
+    return false;
+}
+
+void
+countersStart(scrCounters *counters, pid_t child)
+{
+    (void)child;
+    counters->available = 0;
+}
+
+void
+countersStop(scrCounters *counters)
+{
+    (void)counters;
+}
+
+#endif  // __linux__
+
+void
+showCounters(const scrTest *test, const scrCounters *counters)
+{
+    const char *separator = "";
+
+    if (!counters->available) {
+        return;
+    }
+
+    printf("Counters (%s): ", test->name);
+    for (unsigned int k = 0; k < SCR_NUM_COUNTERS; k++) {
+        if (counters->available & (1 << k)) {
+            printf("%s%llu %s", separator, counters->values[k], counter_names[k]);
+            separator = ", ";
+        }
+    }
+
+    if ((counters->available & (1 << SCR_COUNTER_CYCLES)) &&
+        (counters->available & (1 << SCR_COUNTER_INSTRUCTIONS)) && counters->values[SCR_COUNTER_CYCLES] > 0) {
+        printf(" (%.2f IPC)",
+               (double)counters->values[SCR_COUNTER_INSTRUCTIONS] / counters->values[SCR_COUNTER_CYCLES]);
+    }
+    printf("\n");
+}
@@ -0,0 +1,92 @@
+src/baseline.o: src/baseline.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/benchmark.o: src/benchmark.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/cache.o: src/cache.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/counters.o: src/counters.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/events.o: src/events.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/groups.o: src/groups.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h src/monkeypatch.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/history.o: src/history.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/internal.o: src/internal.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/journal.o: src/journal.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/loop.o: src/loop.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/monkeypatch.o: src/monkeypatch.c src/monkeypatch.h src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/overhead.o: src/overhead.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/patch_runner.o: src/patch_runner.c src/monkeypatch.h src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/report.o: src/report.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/run.o: src/run.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h src/monkeypatch.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/run_test.o: src/run_test.c src/internal.h \
+ /tmp/gearstub/include/gear/gear.h include/scrutiny/scrutiny.h \
+ include/scrutiny/run.h include/scrutiny/definitions.h \
+ include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/select.o: src/select.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/store.o: src/store.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/stream.o: src/stream.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/test.o: src/test.c include/scrutiny/test.h include/scrutiny/definitions.h \
+ src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
+src/trace.o: src/trace.c src/internal.h /tmp/gearstub/include/gear/gear.h \
+ include/scrutiny/scrutiny.h include/scrutiny/run.h \
+ include/scrutiny/definitions.h include/scrutiny/test.h
+	$(CC) $(CFLAGS) -fpic -ffunction-sections -Iinclude -I/tmp/gearstub/include -c $< -o $@
@@ -0,0 +1,461 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+// The group runner's end of the event stream.
+static int event_fd = -1;
+// Whether the runner's own work is being traced.
+static bool tracing;
+
+static const char *const span_names[] = {
+    [SCR_SPAN_SETUP] = "create_fn",
+    [SCR_SPAN_CLEANUP] = "cleanup_fn",
+    [SCR_SPAN_FORK] = "fork",
+    [SCR_SPAN_OUTPUT] = "send output",
+};
+
+static void
+sendEvent(scrEventKind kind, const void *payload, size_t payload_length, const void *data, size_t data_length)
+{
+    // Test reports are much smaller than output events so this fits any event.
+    static unsigned char buffer[sizeof(scrEventHeader) + sizeof(scrEventOutput) + SCR_EVENT_MAX_OUTPUT];
+    scrEventHeader header = {.kind = kind, .length = payload_length + data_length};
+    size_t length = sizeof(header) + header.length, written = 0;
+
+    if (event_fd < 0) {
+        return;
+    }
+
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), payload, payload_length);
+    if (data_length > 0) {
+        memcpy(buffer + sizeof(header) + payload_length, data, data_length);
+    }
+
+    while (written < length) {
+        ssize_t transmitted = write(event_fd, buffer + written, length - written);
+
+        if (transmitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // The top-level process is gone so there's no one left to tell.
+            return;
+        }
+        written += transmitted;
+    }
+}
+
+void
+eventsOpen(int fd, const scrOptions *options)
+{
+    scrEventHello hello = {.magic = SCR_EVENT_MAGIC, .version = SCR_EVENT_VERSION};
+
+    event_fd = fd;
+    tracing = !!options->trace_file;
+    sendEvent(SCR_EVENT_HELLO, &hello, sizeof(hello), NULL, 0);
+}
+
+void
+eventsDetach(void)
+{
+    if (event_fd >= 0) {
+        close(event_fd);
+        event_fd = -1;
+    }
+}
+
+// The span ends now.
+void
+eventSpan(scrSpanKind kind, double start)
+{
+    scrEventSpan span = {.kind = kind, .pid = getpid(), .start = start};
+
+    if (!tracing) {
+        return;
+    }
+
+    span.end = monotonicNow();
+    sendEvent(SCR_EVENT_SPAN, &span, sizeof(span), NULL, 0);
+}
+
+// Sent once the group runner is done so that its overhead is counted along with everyone else's.
+void
+eventOverhead(void)
+{
+    sendEvent(SCR_EVENT_OVERHEAD, overheadTotals(), sizeof(scrOverhead), NULL, 0);
+}
+
+void
+eventTestStarted(const scrTest *test, pid_t pid)
+{
+    scrEventStarted started = {.test_idx = test->idx, .pid = pid, .time = monotonicNow()};
+
+    sendEvent(SCR_EVENT_TEST_STARTED, &started, sizeof(started), NULL, 0);
+}
+
+void
+eventTestFinished(const scrTest *test, scrTestReport *report)
+{
+    report->test_idx = test->idx;
+    report->time = monotonicNow();
+    sendEvent(SCR_EVENT_TEST_FINISHED, report, sizeof(*report), NULL, 0);
+}
+
+void
+eventTestOutput(const scrTest *test, unsigned int stream, bool live, const void *data, size_t length)
+{
+    scrEventOutput output = {.test_idx = test->idx, .stream = stream, .live = live};
+
+    do {
+        size_t chunk = (length > SCR_EVENT_MAX_OUTPUT) ? SCR_EVENT_MAX_OUTPUT : length;
+
+        sendEvent(SCR_EVENT_TEST_OUTPUT, &output, sizeof(output), data, chunk);
+        data = (const char *)data + chunk;
+        length -= chunk;
+    } while (length > 0);
+}
+
+void
+eventTestOutputRange(const scrTest *test, unsigned int stream, int fd, off_t start, off_t end)
+{
+    char buffer[SCR_EVENT_MAX_OUTPUT];
+
+    // pread leaves the file offset alone since a batch worker could still be writing through it.  A negative
+    // end means that everything up to the end of the file is sent.
+    while (end < 0 || start < end) {
+        size_t size = sizeof(buffer);
+        ssize_t transmitted;
+
+        if (end >= 0 && end - start < (off_t)size) {
+            size = end - start;
+        }
+
+        transmitted = pread(fd, buffer, size, start);
+        if (transmitted <= 0) {
+            break;
+        }
+        start += transmitted;
+
+        eventTestOutput(test, stream, false, buffer, transmitted);
+    }
+}
+
+void
+eventReaderInit(scrEventReader *reader, const scrGroupStruct *group, pid_t pid)
+{
+    reader->group = group;
+    reader->pid = pid;
+    reader->section = -1;
+    reader->some_output = false;
+    reader->greeted = false;
+    reader->broken = false;
+    reader->pending = false;
+    reader->length = 0;
+}
+
+static const scrTest *
+findTest(const scrEventReader *reader, size_t test_idx)
+{
+    return (test_idx < reader->group->tests.length) ? GEAR_GET_ITEM(&reader->group->tests, test_idx) : NULL;
+}
+
+static bool
+framed(int stream)
+{
+    return stream == SCR_OUTPUT_STDOUT || stream == SCR_OUTPUT_STDERR;
+}
+
+static void
+endOutput(scrEventReader *reader)
+{
+    if (framed(reader->section)) {
+        printf("\n------------------------\n");
+    }
+    if (reader->some_output) {
+        printf("\n");
+    }
+    reader->section = -1;
+    reader->some_output = false;
+}
+
+static void
+keepExcerpt(scrEventReader *reader, unsigned int stream, const char *data, size_t length)
+{
+    size_t *excerpt_length = &reader->excerpt_lengths[stream];
+
+    if (length > SCR_EXCERPT_SIZE - *excerpt_length) {
+        length = SCR_EXCERPT_SIZE - *excerpt_length;
+        reader->truncated[stream] = true;
+    }
+    memcpy(reader->excerpts[stream] + *excerpt_length, data, length);
+    *excerpt_length += length;
+}
+
+static void
+describeReport(const scrTest *test, const scrTestReport *report, char *buffer, size_t size)
+{
+    switch (report->reason) {
+    case SCR_FINISH_TIMED_OUT: snprintf(buffer, size, "Timed out"); break;
+    case SCR_FINISH_SIGNALED:
+        snprintf(buffer, size, "Terminated by signal (%i): %s", report->signum, strsignal(report->signum));
+        break;
+    case SCR_FINISH_REGRESSED:
+        snprintf(buffer, size, "Regressed from %.3g s (+/- %.3g s) to %.3g s", test->baseline->mean,
+                 test->baseline->stddev, report->timing.mean);
+        break;
+    default: buffer[0] = '\0'; break;
+    }
+}
+
+// The reporters get each result once all of its output has arrived, i.e., once anything else does.
+static void
+passPending(scrEventReader *reader)
+{
+    const scrTest *test;
+    scrReportEntry entry = {.group_idx = reader->group->idx};
+    char reason[128];
+
+    if (!reader->pending) {
+        return;
+    }
+    reader->pending = false;
+
+    test = GEAR_GET_ITEM(&reader->group->tests, reader->report.test_idx);
+    describeReport(test, &reader->report, reason, sizeof(reason));
+    entry.test = test;
+    entry.result = reader->report.result;
+    entry.reason = reason[0] ? reason : NULL;
+    entry.duration = reader->report.usage.wall_time;
+    for (unsigned int k = 0; k < ARRAY_LENGTH(entry.outputs); k++) {
+        if (reader->excerpt_lengths[k] > 0) {
+            entry.outputs[k] = reader->excerpts[k];
+            entry.output_lengths[k] = reader->excerpt_lengths[k];
+            entry.truncated[k] = reader->truncated[k];
+        }
+    }
+    reportersAdd(&entry);
+}
+
+static void
+showOutput(scrEventReader *reader, const scrTest *test, const scrEventOutput *output, char *data,
+           size_t length)
+{
+    if (output->live) {
+        // The group runner has already split streamed output into lines and made it printable.
+        endOutput(reader);
+        printf("[%s%s] %.*s\n", test->name, (output->stream == SCR_OUTPUT_STDERR) ? ":stderr" : "",
+               (int)length, data);
+        return;
+    }
+
+    if ((int)output->stream != reader->section) {
+        if (framed(reader->section)) {
+            printf("\n------------------------\n");
+        }
+        if (framed(output->stream)) {
+            printf("\n-------- %s --------\n", (output->stream == SCR_OUTPUT_STDOUT) ? "stdout" : "stderr");
+        }
+        reader->section = output->stream;
+    }
+
+    if (output->stream != SCR_OUTPUT_LOG) {
+        replaceNonPrintable(data, length);
+    }
+    fwrite(data, 1, length, stdout);
+    reader->some_output = true;
+
+    if (reader->pending && output->test_idx == reader->report.test_idx) {
+        keepExcerpt(reader, output->stream, data, length);
+    }
+}
+
+static void
+showReport(const scrTest *test, const scrTestReport *report)
+{
+    switch (report->reason) {
+    case SCR_FINISH_TIMED_OUT:
+        printf("Test result (%s): %sFAIL%s: Timed out", test->name, show_color ? RED : "",
+               show_color ? RESET_COLOR : "");
+        endResultLine(&report->usage);
+        break;
+
+    case SCR_FINISH_SIGNALED:
+        printf("Test result (%s): %sERROR%s: Terminated by signal (%i): %s", test->name,
+               show_color ? RED : "", show_color ? RESET_COLOR : "", report->signum,
+               strsignal(report->signum));
+        endResultLine(&report->usage);
+        break;
+
+    case SCR_FINISH_REGRESSED:
+        printf("Test result (%s): %sFAILED%s: Regressed from %.3g s (+/- %.3g s) to %.3g s", test->name,
+               show_color ? RED : "", show_color ? RESET_COLOR : "", test->baseline->mean,
+               test->baseline->stddev, report->timing.mean);
+        endResultLine(&report->usage);
+        break;
+
+    default: showTestResult(test, report->result, &report->usage); break;
+    }
+
+    if (report->bench_result.valid) {
+        showBenchmarkResult(test, &report->bench_result);
+    }
+    showCounters(test, &report->counters);
+}
+
+// Payloads are copied out of the buffer since it makes no promises about their alignment.
+static bool
+handleEvent(scrEventReader *reader, const scrEventHeader *header, unsigned char *payload)
+{
+    scrEventHello hello;
+    scrEventStarted started;
+    scrTestReport report;
+    scrEventOutput output;
+    scrEventSpan span;
+    scrOverhead overhead;
+    const scrTest *test;
+
+    if (!reader->greeted) {
+        if (header->kind != SCR_EVENT_HELLO || header->length != sizeof(hello)) {
+            return false;
+        }
+        memcpy(&hello, payload, sizeof(hello));
+        if (hello.magic != SCR_EVENT_MAGIC || hello.version != SCR_EVENT_VERSION) {
+            return false;
+        }
+        reader->greeted = true;
+        return true;
+    }
+
+    switch (header->kind) {
+    case SCR_EVENT_TEST_STARTED:
+        if (header->length != sizeof(started)) {
+            return false;
+        }
+        memcpy(&started, payload, sizeof(started));
+        endOutput(reader);
+        passPending(reader);
+        return findTest(reader, started.test_idx);
+
+    case SCR_EVENT_TEST_FINISHED:
+        if (header->length != sizeof(report)) {
+            return false;
+        }
+        memcpy(&report, payload, sizeof(report));
+        test = findTest(reader, report.test_idx);
+        if (!test || (report.reason == SCR_FINISH_REGRESSED && !test->baseline)) {
+            return false;
+        }
+        endOutput(reader);
+        passPending(reader);
+        showReport(test, &report);
+        traceSpan(reader->pid, report.pid, test->name, "test", report.time - report.usage.wall_time,
+                  report.time);
+        if (reportersActive()) {
+            reader->pending = true;
+            reader->report = report;
+            memset(reader->excerpt_lengths, 0, sizeof(reader->excerpt_lengths));
+            memset(reader->truncated, 0, sizeof(reader->truncated));
+        }
+        return true;
+
+    case SCR_EVENT_TEST_OUTPUT:
+        if (header->length < sizeof(output) || header->length > sizeof(output) + SCR_EVENT_MAX_OUTPUT) {
+            return false;
+        }
+        memcpy(&output, payload, sizeof(output));
+        test = findTest(reader, output.test_idx);
+        if (!test || output.stream > SCR_OUTPUT_LOG) {
+            return false;
+        }
+        showOutput(reader, test, &output, (char *)payload + sizeof(output), header->length - sizeof(output));
+        return true;
+
+    case SCR_EVENT_SPAN:
+        if (header->length != sizeof(span)) {
+            return false;
+        }
+        memcpy(&span, payload, sizeof(span));
+        if (span.kind >= SCR_NUM_SPANS) {
+            return false;
+        }
+        traceSpan(reader->pid, span.pid, span_names[span.kind], "overhead", span.start, span.end);
+        return true;
+
+    case SCR_EVENT_OVERHEAD:
+        if (header->length != sizeof(overhead)) {
+            return false;
+        }
+        memcpy(&overhead, payload, sizeof(overhead));
+        overheadMerge(&overhead);
+        return true;
+
+    default: return false;
+    }
+}
+
+bool
+eventRead(scrEventReader *reader, int fd)
+{
+    ssize_t transmitted;
+    size_t offset = 0;
+
+    transmitted = read(fd, reader->buffer + reader->length, sizeof(reader->buffer) - reader->length);
+    if (transmitted <= 0) {
+        return transmitted < 0 && errno == EINTR;
+    }
+    if (reader->broken) {
+        return true;
+    }
+    reader->length += transmitted;
+
+    while (reader->length - offset >= sizeof(scrEventHeader)) {
+        scrEventHeader header;
+
+        memcpy(&header, reader->buffer + offset, sizeof(header));
+        if (header.length > sizeof(reader->buffer) / 2 - sizeof(header)) {
+            reader->broken = true;
+            break;
+        }
+        if (reader->length - offset - sizeof(header) < header.length) {
+            break;
+        }
+
+        if (!handleEvent(reader, &header, reader->buffer + offset + sizeof(header))) {
+            reader->broken = true;
+            break;
+        }
+        offset += sizeof(header) + header.length;
+    }
+
+    if (reader->broken) {
+        fprintf(stderr, "Ignoring the rest of a malformed event stream from a group runner\n");
+        reader->length = 0;
+    }
+    else {
+        memmove(reader->buffer, reader->buffer + offset, reader->length - offset);
+        reader->length -= offset;
+    }
+
+    fflush(stdout);
+    return true;
+}
+
+void
+eventReplay(scrEventReader *reader, int fd)
+{
+    lseek(fd, 0, SEEK_SET);
+    while (eventRead(reader, fd)) {}
+}
+
+void
+eventReaderFinish(scrEventReader *reader)
+{
+    // Whatever is left over is an event that the group runner died in the middle of sending.
+    endOutput(reader);
+    passPending(reader);
+    fflush(stdout);
+}
@@ -2,13 +2,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "internal.h"
 #include "monkeypatch.h"
 
+// inline_mask is set to the signal mask that inline tests run with.
 static bool
-groupSetup(const scrGroupStruct *group, const scrOptions *options, int error_fd, void **group_ctx)
+groupSetup(const scrGroupStruct *group, const scrOptions *options, int error_fd, void **group_ctx,
+           sigset_t *inline_mask)
 {
     sigset_t set;
 
@@ -18,11 +21,17 @@ groupSetup(const scrGroupStruct *group, const scrOptions *options, int error_fd,
     }
 
     sigfillset(&set);
-    sigprocmask(SIG_SETMASK, &set, NULL);
+    sigprocmask(SIG_SETMASK, &set, inline_mask);
+    // A SIGCHLD which goes missing during an inline test is harmless since the runner reaps its workers
+    // before it waits for more.  SIGTERM is left to a handler so that a test which hangs can't make the
+    // runner unkillable.
 
     if (group->create_fn) {
+        double start = monotonicNow();
+
         setLogFd(error_fd);
         *group_ctx = group->create_fn(options->global_ctx);
+        eventSpan(SCR_SPAN_SETUP, start);
     }
     else {
         *group_ctx = options->global_ctx;
@@ -32,44 +41,405 @@ groupSetup(const scrGroupStruct *group, const scrOptions *options, int error_fd,
     return true;
 }
 
+static void
+groupCleanup(const scrGroupStruct *group, void *group_ctx)
+{
+    if (group->cleanup_fn) {
+        double start = monotonicNow();
+
+        // The results which have been shown so far shouldn't be lost if the cleanup crashes.
+        fflush(stdout);
+        group->cleanup_fn(group_ctx);
+        eventSpan(SCR_SPAN_CLEANUP, start);
+    }
+}
+
+static bool
+succeeded(scrTestCode result)
+{
+    return result == SCR_TEST_CODE_OK || result == SCR_TEST_CODE_SKIP;
+}
+
+// Tells the top-level process that the tests which never finished were left on purpose rather than lost.
+static void
+recordStopped(const scrGroupStruct *group)
+{
+    for (size_t idx = 0; idx < group->tests.length; idx++) {
+        const scrTest *test = GEAR_GET_ITEM(&group->tests, idx);
+
+        if (!test->record->finished) {
+            test->record->stopped = true;
+        }
+    }
+}
+
+// For tests which couldn't even be started.
+static void
+recordError(const scrGroupStruct *group, size_t test_idx)
+{
+    const scrTest *test = GEAR_GET_ITEM(&group->tests, test_idx);
+
+    test->record->result = SCR_TEST_CODE_ERROR;
+    test->record->finished = true;
+}
+
+static bool
+finishRun(scrTestRun *run, int status, bool timed_out, bool verbose)
+{
+    bool ok = true;
+    scrTestCode result;
+
+    workerOverhead(run);
+    // A batch reports every test that its worker finished and then the one that it died in, if any.
+    while (batchReport(run, verbose, &result)) {
+        ok = succeeded(result) && ok;
+    }
+    if (run->test) {
+        ok = succeeded(testFinish(run, status, timed_out, verbose)) && ok;
+    }
+
+    return ok;
+}
+
+static void *
+mapShared(size_t size)
+{
+    void *ptr;
+
+    ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    return ptr;
+}
+
+static bool
+slotInit(scrTestRun *run, const scrGroupStruct *group, scrEventLoop *loop, unsigned int flags, bool batching)
+{
+    bool streaming = flags & SCR_RF_STREAM;
+
+    run->group = group;
+    run->loop = loop;
+    run->streaming = streaming;
+    run->counting = !!(flags & SCR_RF_COUNTERS);
+    run->fail_fast = !!(flags & SCR_RF_FAIL_FAST);
+#ifdef SCR_MONKEYPATCH
+    // With SCR_RF_PATCH_ONCE, the workers inherit the group runner's patches instead.
+    run->have_patches = (group->patch_goals.length > 0 && !(flags & SCR_RF_PATCH_ONCE));
+#endif
+
+    // Benchmarks and batches report their results through shared memory since they run in the forked child.
+    // So does the worker's own setup since it's part of the framework's overhead.
+    run->bench_result = mapShared(sizeof(*run->bench_result));
+    if (!run->bench_result) {
+        return false;
+    }
+    run->redirect_time = mapShared(sizeof(*run->redirect_time));
+    if (!run->redirect_time) {
+        goto error;
+    }
+
+    if (batching) {
+        run->batch = mapShared(sizeof(*run->batch));
+        if (!run->batch) {
+            goto error;
+        }
+    }
+
+    if (!streaming && !captureInit(run)) {
+        goto error;
+    }
+
+    return true;
+
+error:
+    munmap(run->bench_result, sizeof(*run->bench_result));
+    if (run->redirect_time) {
+        munmap(run->redirect_time, sizeof(*run->redirect_time));
+    }
+    if (run->batch) {
+        munmap(run->batch, sizeof(*run->batch));
+    }
+    return false;
+}
+
+static void
+freeRuns(scrTestRun *runs, unsigned int num_runs, scrEventLoop *loop)
+{
+    // Each worker has copies of the command pipes of the workers which were forked before it.  So none of
+    // them can tell that it's being retired until all of the pipes have been closed.
+    for (unsigned int k = 0; k < num_runs; k++) {
+        if (runs[k].idle) {
+            close(runs[k].command_fd);
+        }
+    }
+
+    for (unsigned int k = 0; k < num_runs; k++) {
+        if (runs[k].idle) {
+            testRetire(&runs[k]);
+        }
+        if (!runs[k].streaming) {
+            captureFree(&runs[k]);
+        }
+        munmap(runs[k].bench_result, sizeof(*runs[k].bench_result));
+        munmap(runs[k].redirect_time, sizeof(*runs[k].redirect_time));
+        if (runs[k].batch) {
+            munmap(runs[k].batch, sizeof(*runs[k].batch));
+        }
+    }
+    free(runs);
+    loopDestroy(loop);
+}
+
+static scrTestRun *
+resumableSlot(scrTestRun *runs, unsigned int num_slots)
+{
+    for (unsigned int k = 0; k < num_slots; k++) {
+        if (!runs[k].test && runs[k].test_idx < runs[k].batch_end) {
+            return &runs[k];
+        }
+    }
+
+    return NULL;
+}
+
+static scrTestRun *
+freeSlot(scrTestRun *runs, unsigned int num_slots)
+{
+    scrTestRun *empty = NULL;
+
+    for (unsigned int k = 0; k < num_slots; k++) {
+        if (runs[k].idle) {
+            return &runs[k];
+        }
+        if (!runs[k].test && !empty) {
+            empty = &runs[k];
+        }
+    }
+
+    return empty;
+}
+
+static void
+fillPool(scrTestRun *runs, unsigned int num_slots, unsigned int pool_size, size_t num_remaining)
+{
+    unsigned int num_idle = 0;
+
+    for (unsigned int k = 0; k < num_slots; k++) {
+        num_idle += runs[k].idle;
+    }
+
+    for (unsigned int k = 0; k < num_slots && num_idle < pool_size && num_idle < num_remaining; k++) {
+        if (!runs[k].test && !runs[k].idle) {
+            if (!testPrefork(&runs[k])) {
+                return;
+            }
+            num_idle++;
+        }
+    }
+}
+
+// A timeout can't be enforced on a test which runs inside of the runner so only tests without one can.
+static bool
+canInline(const scrTest *test)
+{
+    return !test->bench_fn && test->options.timeout == 0;
+}
+
+// Plain tests are batched so that every job gets a share of the remaining tests.  Benchmarks run alone.
+static size_t
+batchLength(const scrGroupStruct *group, size_t test_idx, unsigned int num_jobs)
+{
+    size_t max_length = (group->tests.length - test_idx + num_jobs - 1) / num_jobs, length;
+
+    if (max_length > SCR_BATCH_SIZE) {
+        max_length = SCR_BATCH_SIZE;
+    }
+
+    for (length = 0; length < max_length; length++) {
+        const scrTest *test = GEAR_GET_ITEM(&group->tests, test_idx + length);
+
+        if (test->bench_fn) {
+            break;
+        }
+    }
+
+    return length;
+}
+
 int
-groupDo(const scrGroupStruct *group, const scrOptions *options, int error_fd, int pipe_fd)
+groupDo(const scrGroupStruct *group, const scrOptions *options, int error_fd)
 {
+    bool verbose = options->flags & SCR_RF_VERBOSE, fail_fast = options->flags & SCR_RF_FAIL_FAST,
+         keep_going = true, batching, inlining;
+    unsigned int num_jobs, pool_size, num_slots, num_runs, num_running = 0;
+    size_t next_test = 0;
     void *group_ctx;
-    scrStats stats_obj = {0};
-    scrTest *test;
+    scrTestRun *runs, *inline_run = NULL;
+    scrEventLoop *loop;
+    scrIsolation isolation;
+    sigset_t inline_mask, runner_mask;
+#ifdef SCR_MONKEYPATCH
+    bool patch_runner = (group->patch_goals.length > 0 && (options->flags & SCR_RF_PATCH_ONCE));
+    gear originals;
+#endif
 
-    if (!groupSetup(group, options, error_fd, &group_ctx)) {
+    if (!groupSetup(group, options, error_fd, &group_ctx, &inline_mask)) {
         return SCR_TEST_CODE_ERROR;
     }
 
-    GEAR_FOR_EACH(&group->tests, test)
-    {
-        int result;
+    num_jobs = jobCount(group->max_jobs);
+    if (num_jobs > group->tests.length) {
+        num_jobs = group->tests.length;
+    }
+    pool_size = options->pool_size;
+    if (pool_size > group->tests.length) {
+        pool_size = group->tests.length;
+    }
+
+    // Streamed output and counters are attributed to tests by process so they need a process per test.
+    isolation = group->isolation ? group->isolation : options->isolation;
+    if (options->flags & (SCR_RF_STREAM | SCR_RF_COUNTERS)) {
+        isolation = SCR_ISOLATION_TEST;
+    }
+    batching = (isolation == SCR_ISOLATION_BATCH);
+    inlining = (isolation == SCR_ISOLATION_NONE);
+
+    // Idle workers need slots of their own so that they can be forked while the other tests are running.
+    // Inline tests get one more slot after those.
+    num_slots = num_jobs + pool_size;
+    num_runs = num_slots + inlining;
+    runs = calloc(num_runs, sizeof(*runs));
+    if (!runs) {
+        groupCleanup(group, group_ctx);
+        return SCR_TEST_CODE_ERROR;
+    }
+
+    loop = loopCreate(num_jobs);
+    if (!loop) {
+        free(runs);
+        groupCleanup(group, group_ctx);
+        return SCR_TEST_CODE_ERROR;
+    }
+
+    for (unsigned int k = 0; k < num_runs; k++) {
+        if (!slotInit(&runs[k], group, loop, options->flags, batching)) {
+            num_runs = k;
+            goto error;
+        }
+    }
+    if (inlining) {
+        inline_run = &runs[num_slots];
+    }
+
+#ifdef SCR_MONKEYPATCH
+    // create_fn and cleanup_fn still see the real functions.
+    if (patch_runner && !patchRunner(&group->patch_goals, &originals)) {
+        goto error;
+    }
+#endif
+
+    while (1) {
+        int status;
+        bool timed_out;
+        pid_t child;
+        struct rusage rusage;
+
+        while (keep_going && num_running < num_jobs) {
+            scrTestRun *run = resumableSlot(runs, num_slots);
+            size_t test_idx, batch_length;
+            bool ok;
+
+            if (run) {
+                // The batch's last worker died so a new one picks up after the test that it died on.
+                test_idx = run->test_idx;
+                batch_length = run->batch_end - test_idx;
+            }
+            else if (next_test >= group->tests.length) {
+                break;
+            }
+            else if (inlining && canInline(GEAR_GET_ITEM(&group->tests, next_test))) {
+                run = inline_run;
+                test_idx = next_test++;
+                batch_length = 0;
+            }
+            else {
+                run = freeSlot(runs, num_slots);
+                test_idx = next_test;
+                batch_length = batching ? batchLength(group, test_idx, num_jobs) : 0;
+                next_test += (batch_length > 0) ? batch_length : 1;
+            }
+
+            if (run == inline_run) {
+                // The test gets the caller's signal mask rather than the runner's, which blocks everything.
+                loopCatchTerm(loop);
+                sigprocmask(SIG_SETMASK, &inline_mask, &runner_mask);
+                ok = succeeded(testInline(run, test_idx, verbose));
+                sigprocmask(SIG_SETMASK, &runner_mask, NULL);
+                loopCatchTerm(NULL);
+            }
+            else if (!testStart(run, test_idx, batch_length)) {
+                run->test_idx = run->batch_end;
+                do {
+                    recordError(group, test_idx++);
+                } while (batch_length-- > 1);
+                ok = false;
+            }
+            else if (run->reaped) {
+                ok = finishRun(run, run->status, false, verbose);
+            }
+            else {
+                num_running++;
+                continue;
+            }
+
+            if (!ok && fail_fast) {
+                keep_going = false;
+            }
+        }
 
-        result = testRun(test, options->flags & SCR_RF_VERBOSE);
-        switch (result) {
-        case SCR_TEST_CODE_OK: stats_obj.num_passed++; break;
-        case SCR_TEST_CODE_SKIP: stats_obj.num_skipped++; break;
-        case SCR_TEST_CODE_FAIL: stats_obj.num_failed++; break;
-        default: stats_obj.num_errored++; break;
+        if (keep_going) {
+            fillPool(runs, num_slots, pool_size, group->tests.length - next_test);
         }
 
-        if ((options->flags) & SCR_RF_FAIL_FAST && result != SCR_TEST_CODE_OK &&
-            result != SCR_TEST_CODE_SKIP) {
+        if (num_running == 0) {
             break;
         }
+
+        child = loopWaitChild(loop, &status, &rusage, &timed_out);
+        for (unsigned int k = 0; k < num_slots; k++) {
+            scrTestRun *run = &runs[k];
+
+            if (run->test && run->child == child) {
+                run->rusage = rusage;
+                if (!finishRun(run, status, timed_out, verbose) && fail_fast) {
+                    keep_going = false;
+                }
+                break;
+            }
+        }
+        num_running--;
     }
 
-    if (group->cleanup_fn) {
-        group->cleanup_fn(group_ctx);
+    freeRuns(runs, num_runs, loop);
+    if (!keep_going) {
+        recordStopped(group);
     }
 
-    if (write(pipe_fd, &stats_obj, sizeof(stats_obj)) != (ssize_t)sizeof(stats_obj)) {
-        return SCR_TEST_CODE_ERROR;
+#ifdef SCR_MONKEYPATCH
+    if (patch_runner) {
+        unpatchRunner(&originals);
     }
+#endif
 
+    groupCleanup(group, group_ctx);
     return SCR_TEST_CODE_OK;
+
+error:
+    freeRuns(runs, num_runs, loop);
+    groupCleanup(group, group_ctx);
+    return SCR_TEST_CODE_ERROR;
 }
 
 void
@@ -87,6 +457,36 @@ scrGroupAddTest(scrGroup group, const char *name, scrTestFn test_fn, const scrTe
         exit(1);
     }
 
+    test.idx = gs->tests.length;
+
+#ifdef SCR_MONKEYPATCH
+    test.patch_goals = &gs->patch_goals;
+#endif
+
+    if (gearAppend(&gs->tests, &test) != GEAR_RET_OK) {
+        exit(1);
+    }
+}
+
+void
+scrGroupAddBenchmark(scrGroup group, const char *name, scrBenchmarkFn bench_fn,
+                     const scrBenchmarkOptions *options)
+{
+    scrGroupStruct *gs = GEAR_GET_ITEM(&groups, group);
+    scrTest test = {.bench_fn = bench_fn};
+
+    if (options) {
+        memcpy(&test.bench_options, options, sizeof(*options));
+        test.options.timeout = options->timeout;
+    }
+
+    test.name = strdup(name);
+    if (!test.name) {
+        exit(1);
+    }
+
+    test.idx = gs->tests.length;
+
 #ifdef SCR_MONKEYPATCH
     test.patch_goals = &gs->patch_goals;
 #endif
@@ -96,6 +496,22 @@ scrGroupAddTest(scrGroup group, const char *name, scrTestFn test_fn, const scrTe
     }
 }
 
+void
+scrGroupSetJobs(scrGroup group, unsigned int max_jobs)
+{
+    scrGroupStruct *gs = GEAR_GET_ITEM(&groups, group);
+
+    gs->max_jobs = max_jobs;
+}
+
+void
+scrGroupSetIsolation(scrGroup group, scrIsolation isolation)
+{
+    scrGroupStruct *gs = GEAR_GET_ITEM(&groups, group);
+
+    gs->isolation = isolation;
+}
+
 bool
 scrGroupPatchFunction(scrGroup group, const char *func_name, const char *file_substring, void *new_func)
 {
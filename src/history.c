@@ -0,0 +1,248 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "internal.h"
+
+#define HISTORY_HEADER "# scrutiny history 1\n"
+
+// How far each run moves the recorded durations toward its own.
+#define HISTORY_WEIGHT 0.5
+
+typedef struct historyEntry {
+    scrStoreKey key; // The name is NULL for a group's entry.
+    double duration;
+} historyEntry;
+
+typedef struct scheduleItem {
+    size_t idx;
+    double duration;
+} scheduleItem;
+
+static scrStore entries;
+static bool loaded;
+
+static bool
+parseEntry(scrStore *store, char *line, void *arg)
+{
+    historyEntry entry = {0};
+    char kind;
+    int name_offset;
+    (void)arg;
+
+    if (sscanf(line, "%c %zu %lf %n", &kind, &entry.key.group_idx, &entry.duration, &name_offset) != 3 ||
+        (kind != 'g' && kind != 't')) {
+        return false;
+    }
+
+    if (kind == 't') {
+        entry.key.name = line + name_offset;
+    }
+    return storeAdd(store, &entry) != NULL;
+}
+
+void
+historyLoad(const scrOptions *options)
+{
+    FILE *file;
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    loaded = false;
+    if (!options->history_file) {
+        return;
+    }
+
+    storeInit(&entries, sizeof(historyEntry));
+
+    file = fopen(options->history_file, "r");
+    if (file) {
+        // The history only guides scheduling so a bad file is ignored rather than failing the run.
+        if (!storeRead(&entries, file, HISTORY_HEADER, parseEntry, NULL)) {
+            fprintf(stderr, "Ignoring malformed history file: %s\n", options->history_file);
+            historyFree();
+            storeInit(&entries, sizeof(historyEntry));
+        }
+        fclose(file);
+    }
+    else if (errno != ENOENT) {
+        perror("fopen");
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        historyEntry *entry = storeFind(&entries, group_idx, NULL);
+        scrTest *test;
+
+        group->expected_time = entry ? entry->duration : -1;
+        group->run_time = -1;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            entry = storeFind(&entries, group_idx, test->name);
+            test->expected_time = entry ? entry->duration : -1;
+        }
+    }
+
+    loaded = true;
+}
+
+static bool
+updateEntry(size_t group_idx, const char *name, double duration)
+{
+    historyEntry *entry, new_entry = {.key = {group_idx, (char *)name}, .duration = duration};
+
+    entry = storeFind(&entries, group_idx, name);
+    if (entry) {
+        entry->duration += HISTORY_WEIGHT * (duration - entry->duration);
+        return true;
+    }
+
+    return storeAdd(&entries, &new_entry) != NULL;
+}
+
+static bool
+updateEntries(void)
+{
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    // Entries for groups and tests which didn't run this time are kept as they are.
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        if (group->run_time >= 0 && !updateEntry(group_idx, NULL, group->run_time)) {
+            return false;
+        }
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            if (test->record && test->record->finished &&
+                !updateEntry(group_idx, test->name, test->record->usage.wall_time)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void
+writeEntries(FILE *file)
+{
+    historyEntry *entry;
+
+    fputs(HISTORY_HEADER, file);
+    GEAR_FOR_EACH(&entries.entries, entry)
+    {
+        if (entry->key.name) {
+            fprintf(file, "t %zu %.6g %s\n", entry->key.group_idx, entry->duration, entry->key.name);
+        }
+        else {
+            fprintf(file, "g %zu %.6g\n", entry->key.group_idx, entry->duration);
+        }
+    }
+}
+
+void
+historySave(const scrOptions *options)
+{
+    if (!loaded) {
+        return;
+    }
+
+    if (!updateEntries()) {
+        fprintf(stderr, "Failed to update the history\n");
+        return;
+    }
+
+    storeWrite(options->history_file, "history", writeEntries);
+}
+
+void
+historyFree(void)
+{
+    storeFree(&entries);
+}
+
+bool
+historyLoaded(void)
+{
+    return loaded;
+}
+
+// Unknown durations go first since they could be anything.  Ties keep their registration order.
+static int
+compareItems(const void *item1, const void *item2)
+{
+    const scheduleItem *a = item1, *b = item2;
+    bool a_known = (a->duration >= 0), b_known = (b->duration >= 0);
+
+    if (a_known != b_known) {
+        return a_known - b_known;
+    }
+    if (a->duration != b->duration) {
+        return (a->duration < b->duration) - (a->duration > b->duration);
+    }
+    return (a->idx > b->idx) - (a->idx < b->idx);
+}
+
+bool
+historyScheduleGroups(size_t *order)
+{
+    scheduleItem *items;
+    scrGroupStruct *group;
+    size_t idx;
+
+    items = malloc(sizeof(*items) * groups.length);
+    if (!items) {
+        return false;
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, idx)
+    {
+        items[idx].idx = idx;
+        items[idx].duration = group->expected_time;
+    }
+    qsort(items, groups.length, sizeof(*items), compareItems);
+
+    for (idx = 0; idx < groups.length; idx++) {
+        order[idx] = items[idx].idx;
+    }
+
+    free(items);
+    return true;
+}
+
+void
+historyScheduleTests(scrGroupStruct *group)
+{
+    size_t length = group->tests.length;
+    scheduleItem *items;
+    scrTest *tests, *test;
+    size_t idx;
+
+    items = malloc(sizeof(*items) * length);
+    tests = malloc(sizeof(*tests) * length);
+    if (!items || !tests) {
+        goto done;
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&group->tests, test, idx)
+    {
+        items[idx].idx = idx;
+        items[idx].duration = test->expected_time;
+        tests[idx] = *test;
+    }
+    qsort(items, length, sizeof(*items), compareItems);
+
+    // The group runner has its own copy of the tests so reordering them doesn't affect anything else.
+    for (idx = 0; idx < length; idx++) {
+        *(scrTest *)GEAR_GET_ITEM(&group->tests, idx) = tests[items[idx].idx];
+    }
+
+done:
+    free(items);
+    free(tests);
+}
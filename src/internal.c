@@ -1,16 +1,25 @@
 #include <ctype.h>
-#include <signal.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/syscall.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "internal.h"
 
+// Older C libraries don't declare memfd_create's flags.
+#if defined(SYS_memfd_create) && !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define FNV_PRIME 0x100000001b3ULL
+
 bool show_color;
 
-static void
+void
 replaceNonPrintable(char *buffer, size_t size)
 {
     for (size_t k = 0; k < size; k++) {
@@ -22,32 +31,57 @@ replaceNonPrintable(char *buffer, size_t size)
     }
 }
 
-static void
-killAndExit(pid_t child)
+unsigned int
+jobCount(unsigned int max_jobs)
 {
-    kill(child, SIGKILL);
-    while (waitpid(child, NULL, 0) < 0) {}
-    _exit(1);
+    long num_cpus;
+
+    if (max_jobs > 0) {
+        return max_jobs;
+    }
+
+    num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num_cpus > 0) ? num_cpus : 1;
 }
 
 pid_t
 cleanFork(void)
 {
-    fflush(stdout);
-    fflush(stderr);
+    // A child which calls exit would write out anything left in the buffers a second time.  That includes the
+    // reports and the trace, not just stdout and stderr.
+    fflush(NULL);
     return fork();
 }
 
 void
 dumpFd(int fd, bool printable_only)
+{
+    dumpFdRange(fd, 0, -1, printable_only);
+}
+
+void
+dumpFdRange(int fd, off_t start, off_t end, bool printable_only)
 {
     ssize_t transmitted;
     char buffer[1024];
 
     fflush(stdout);
-    lseek(fd, 0, SEEK_SET);
+    lseek(fd, start, SEEK_SET);
+
+    // A negative end means that everything up to the end of the file is dumped.
+    while (end < 0 || start < end) {
+        size_t size = sizeof(buffer);
+
+        if (end >= 0 && end - start < (off_t)size) {
+            size = end - start;
+        }
+
+        transmitted = read(fd, buffer, size);
+        if (transmitted <= 0) {
+            break;
+        }
+        start += transmitted;
 
-    while ((transmitted = read(fd, buffer, sizeof(buffer))) > 0) {
         if (printable_only) {
             replaceNonPrintable(buffer, transmitted);
         }
@@ -56,160 +90,152 @@ dumpFd(int fd, bool printable_only)
 }
 
 void
-showTestResult(const scrTest *test, scrTestCode result)
+endResultLine(const scrUsage *usage)
 {
-    bool xfail = (test->options.flags & SCR_TF_XFAIL);
-
-    printf("Test result (%s): ", test->name);
-    switch (result) {
-    case SCR_TEST_CODE_OK:
-        printf("%s%s%s\n", show_color ? GREEN : "", xfail ? "XFAILED" : "PASSED",
-               show_color ? RESET_COLOR : "");
-        break;
-
-    case SCR_TEST_CODE_SKIP:
-        printf("%sSKIPPED%s\n", show_color ? YELLOW : "", show_color ? RESET_COLOR : "");
-        break;
-
-    case SCR_TEST_CODE_FAIL:
-        printf("%s%s%s\n", show_color ? RED : "", xfail ? "XPASSED" : "FAILED",
-               show_color ? RESET_COLOR : "");
-        break;
-
-    default: printf("%sERROR%s\n", show_color ? RED : "", show_color ? RESET_COLOR : ""); break;
+    if (usage) {
+        printf(" (%.3fs, user %.3fs, sys %.3fs, max RSS %li KiB, %li/%li context switches)", usage->wall_time,
+               usage->user_time, usage->system_time, usage->max_rss, usage->voluntary_switches,
+               usage->involuntary_switches);
     }
+    printf("\n");
 }
 
-#ifdef SYS_pidfd_open
-
-#include <errno.h>
-#include <poll.h>
-#include <string.h>
-#include <sys/signalfd.h>
-#include <sys/timerfd.h>
-
-void
-waitForProcess(pid_t child, unsigned int timeout, int *status, bool *timed_out)
+// Folds the bytes into an FNV-1a hash.
+uint64_t
+hashBytes(uint64_t hash, const void *data, size_t size)
 {
-    unsigned int num_pollers;
-    struct pollfd pollers[3] = {{.events = POLLIN}, {.events = POLLIN}};
-    sigset_t set;
+    const unsigned char *bytes = data;
 
-    *timed_out = false;
-
-    pollers[0].fd = syscall(SYS_pidfd_open, child, 0);
-    if (pollers[0].fd < 0) {
-        perror("pidfd_open");
-        goto error;
-    }
-
-    sigemptyset(&set);
-    sigaddset(&set, SIGTERM);
-    pollers[1].fd = signalfd(-1, &set, 0);
-    if (pollers[1].fd < 0) {
-        perror("signalfd");
-        goto error;
+    for (size_t k = 0; k < size; k++) {
+        hash ^= bytes[k];
+        hash *= FNV_PRIME;
     }
+    return hash;
+}
 
-    if (timeout > 0) {
-        struct itimerspec timer = {.it_value = {.tv_sec = timeout}};
-
-        num_pollers = 3;
-        pollers[2].events = POLLIN;
-        pollers[2].fd = timerfd_create(CLOCK_MONOTONIC, 0);
-        if (pollers[2].fd < 0) {
-            perror("timerfd_create");
-            goto error;
-        }
+// Hashes the key which persisted files and shards identify a test by.  A NULL name is for the group itself.
+uint64_t
+hashTest(size_t group_idx, const char *name)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
 
-        if (timerfd_settime(pollers[2].fd, 0, &timer, NULL) != 0) {
-            perror("timerfd_settime");
-            goto error;
-        }
-    }
-    else {
-        num_pollers = 2;
+    if (name) {
+        hash = hashBytes(hash, name, strlen(name));
     }
+    hash ^= group_idx;
+    hash *= FNV_PRIME;
 
-    while (poll(pollers, num_pollers, -1) < 0) {
-        int local_errno = errno;
+    return hash;
+}
 
-        if (local_errno != EINTR) {
-            fprintf(stderr, "poll: %s\n", strerror(local_errno));
-            goto error;
-        }
-    }
+int
+makeTempFile(char *template)
+{
+    int fd;
 
-    for (unsigned int k = 0; k < num_pollers; k++) {
-        close(pollers[k].fd);
+#ifdef SYS_memfd_create
+    fd = syscall(SYS_memfd_create, "scrutiny", MFD_CLOEXEC);
+    if (fd >= 0) {
+        return fd;
     }
+#endif
 
-    if (pollers[1].revents & POLLIN) {
-        goto error;
+    fd = mkstemp(template);
+    if (fd < 0) {
+        perror("mkstemp");
     }
-    if (num_pollers == 3 && pollers[2].revents & POLLIN) {
-        *timed_out = true;
-        kill(child, SIGKILL);
+    else {
+        unlink(template);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
     }
+    return fd;
+}
 
-    while (waitpid(child, status, 0) < 0) {}
-    return;
+double
+monotonicNow(void)
+{
+    struct timespec now;
 
-error:
-    killAndExit(child);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
 }
 
-#else  // SYS_pidfd_open
-
-#include <time.h>
+#define MERGE_FIELD(field)                         \
+    do {                                           \
+        stats->total_usage.field += total->field;  \
+        if (max->field > stats->max_usage.field) { \
+            stats->max_usage.field = max->field;   \
+        }                                          \
+    } while (0)
 
-#ifdef CLOCK_MONOTONIC_COARSE
-#define SCR_CLOCK_TYPE CLOCK_MONOTONIC_COARSE
-#else
-#define SCR_CLOCK_TYPE CLOCK_MONOTONIC
-#endif
+void
+mergeUsage(scrStats *stats, const scrUsage *total, const scrUsage *max)
+{
+    MERGE_FIELD(wall_time);
+    MERGE_FIELD(user_time);
+    MERGE_FIELD(system_time);
+    MERGE_FIELD(max_rss);
+    MERGE_FIELD(voluntary_switches);
+    MERGE_FIELD(involuntary_switches);
+}
 
-#define ONE_TENTH_SECOND 10000000
+#undef MERGE_FIELD
 
-static bool
-caughtSignal(void)
+void
+showCachedResult(const scrTest *test)
 {
-    sigset_t set;
-
-    sigpending(&set);
-    return sigismember(&set, SIGTERM);
+    printf("Test result (%s): %s%s%s (cached)\n", test->name, show_color ? GREEN : "",
+           (test->options.flags & SCR_TF_XFAIL) ? "XFAILED" : "PASSED", show_color ? RESET_COLOR : "");
 }
 
 void
-waitForProcess(pid_t child, unsigned int timeout, int *status, bool *timed_out)
+showTestResult(const scrTest *test, scrTestCode result, const scrUsage *usage)
 {
-    struct timespec start_time, lapse = {.tv_nsec = ONE_TENTH_SECOND};
+    bool xfail = (test->options.flags & SCR_TF_XFAIL);
 
-    *timed_out = false;
-    if (timeout > 0) {
-        clock_gettime(SCR_CLOCK_TYPE, &start_time);
-    }
+    printf("Test result (%s): ", test->name);
+    switch (result) {
+    case SCR_TEST_CODE_OK:
+        printf("%s%s%s", show_color ? GREEN : "", xfail ? "XFAILED" : "PASSED",
+               show_color ? RESET_COLOR : "");
+        break;
 
-    while (1) {
-        if (caughtSignal()) {
-            killAndExit(child);
-        }
+    case SCR_TEST_CODE_SKIP:
+        printf("%sSKIPPED%s", show_color ? YELLOW : "", show_color ? RESET_COLOR : "");
+        break;
 
-        if (waitpid(child, status, WNOHANG) == child) {
-            return;
-        }
+    case SCR_TEST_CODE_FAIL:
+        printf("%s%s%s", show_color ? RED : "", xfail ? "XPASSED" : "FAILED", show_color ? RESET_COLOR : "");
+        break;
+
+    default: printf("%sERROR%s", show_color ? RED : "", show_color ? RESET_COLOR : ""); break;
+    }
 
-        nanosleep(&lapse, NULL);
-        if (timeout > 0 && !*timed_out) {
-            struct timespec now;
+    endResultLine(usage);
+}
 
-            clock_gettime(SCR_CLOCK_TYPE, &now);
-            if (now.tv_sec - start_time.tv_sec >= timeout) {
-                *timed_out = true;
-                kill(child, SIGKILL);
+void
+writeJson(FILE *file, const char *string, size_t length)
+{
+    fputc('"', file);
+    for (size_t k = 0; k < length; k++) {
+        unsigned char c = string[k];
+
+        switch (c) {
+        case '"': fputs("\\\"", file); break;
+        case '\\': fputs("\\\\", file); break;
+        case '\n': fputs("\\n", file); break;
+        case '\r': fputs("\\r", file); break;
+        case '\t': fputs("\\t", file); break;
+        default:
+            if (c < 0x20 || c == 0x7f) {
+                fprintf(file, "\\u%04x", c);
             }
+            else {
+                fputc(c, file);
+            }
+            break;
         }
     }
+    fputc('"', file);
 }
-
-#endif  // SYS_pidfd_open
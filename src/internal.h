@@ -1,7 +1,12 @@
 #pragma once
 
+#include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include <gear/gear.h>
 
@@ -14,10 +19,34 @@ typedef enum scrTestCode {
     SCR_TEST_CODE_SKIP,
 } scrTestCode;
 
+typedef struct scrTiming {
+    unsigned int samples;
+    double mean;
+    double stddev;
+} scrTiming;
+
+typedef struct scrTestRecord {
+    scrTestCode result;
+    bool finished;
+    bool stopped; // The runner left the test unfinished because SCR_RF_FAIL_FAST stopped it.
+    scrUsage usage;
+    scrTiming timing;
+} scrTestRecord;
+
 typedef struct scrTest {
     scrTestFn *test_fn;
+    scrBenchmarkFn *bench_fn;
     char *name;
     scrTestOptions options;
+    scrBenchmarkOptions bench_options;
+    scrTestRecord *record;
+    const scrTiming *baseline;
+    size_t idx;           // Where the test was added to its group, which is how events refer to it.
+    double expected_time; // From the history or negative if unknown.
+    bool selected;        // Whether the test runs in the current phase of the run.
+    bool deferred;        // Whether the test runs in a later phase.
+    bool failed_before;   // Whether the journal says that the test failed last time.
+    bool cached;          // Whether the cache says that the test passed with the same binary.
 #ifdef SCR_MONKEYPATCH
     gear *patch_goals;
 #endif
@@ -36,46 +65,576 @@ typedef struct scrGroupStruct {
     scrCtxCreateFn *create_fn;
     scrCtxCleanupFn *cleanup_fn;
     gear tests;
+    unsigned int max_jobs;
+    scrIsolation isolation;
+    double expected_time; // From the history or negative if unknown.
+    double run_time;      // How long the group took in this run or negative if it didn't finish.
+    size_t num_selected;  // How many of the tests belong to this process's shard.
+    size_t idx;           // The group's handle.
 #ifdef SCR_MONKEYPATCH
     gear patch_goals;
 #endif
 } scrGroupStruct;
 
+typedef struct scrBenchmarkResult {
+    bool valid;
+    unsigned int repetitions;
+    unsigned long iterations;
+    double min;
+    double median;
+    double mean;
+    double stddev;
+} scrBenchmarkResult;
+
+enum {
+    SCR_COUNTER_CYCLES = 0,
+    SCR_COUNTER_INSTRUCTIONS,
+    SCR_COUNTER_CACHE_MISSES,
+    SCR_COUNTER_BRANCH_MISSES,
+
+    SCR_NUM_COUNTERS,
+};
+
+typedef struct scrCounters {
+    int fds[SCR_NUM_COUNTERS];
+    unsigned long long values[SCR_NUM_COUNTERS];
+    unsigned int available; // A bitmask of the counters that could be opened.
+} scrCounters;
+
+// The most tests that a batch worker will run before it's replaced.
+#define SCR_BATCH_SIZE 100
+
+typedef struct scrBatchEntry {
+    scrTestCode result;
+    scrUsage usage;
+    off_t output_ends[3]; // Where the test's stdout, stderr, and log output end in the capture files.
+} scrBatchEntry;
+
+typedef struct scrBatch {
+    size_t num_started;
+    size_t num_finished;
+    struct timespec start; // When the current test started.
+    scrUsage base_usage;   // The worker's usage before the current test started.
+    scrBatchEntry entries[SCR_BATCH_SIZE];
+} scrBatch;
+
+enum {
+    SCR_OUTPUT_STDOUT = 0,
+    SCR_OUTPUT_STDERR,
+    SCR_OUTPUT_LOG,
+};
+
+// Group runners describe everything that happens to their tests with a stream of events and the top-level
+// process is the one which shows them.  Both sides are the same binary so payloads are sent as raw structs.
+#define SCR_EVENT_MAGIC   0x73637245
+#define SCR_EVENT_VERSION 3
+
+// The most output that a single event carries.
+#define SCR_EVENT_MAX_OUTPUT 4096
+
+typedef enum scrEventKind {
+    SCR_EVENT_HELLO = 1,
+    SCR_EVENT_TEST_STARTED,
+    SCR_EVENT_TEST_FINISHED,
+    SCR_EVENT_TEST_OUTPUT,
+    SCR_EVENT_SPAN,
+    SCR_EVENT_OVERHEAD,
+} scrEventKind;
+
+typedef struct scrEventHeader {
+    uint32_t kind;
+    uint32_t length; // The length of the payload which follows.
+} scrEventHeader;
+
+typedef struct scrEventHello {
+    uint32_t magic;
+    uint32_t version;
+} scrEventHello;
+
+typedef struct scrEventStarted {
+    size_t test_idx;
+    pid_t pid;   // The process which runs the test.
+    double time; // CLOCK_MONOTONIC seconds.
+} scrEventStarted;
+
+typedef enum scrFinishReason {
+    SCR_FINISH_EXITED = 0,
+    SCR_FINISH_TIMED_OUT,
+    SCR_FINISH_SIGNALED,
+    SCR_FINISH_REGRESSED,
+} scrFinishReason;
+
+typedef struct scrTestReport {
+    size_t test_idx;
+    pid_t pid; // The process which ran the test.
+    scrTestCode result;
+    scrFinishReason reason;
+    int signum;
+    double time; // CLOCK_MONOTONIC seconds.
+    scrUsage usage;
+    scrTiming timing;
+    scrBenchmarkResult bench_result;
+    scrCounters counters;
+} scrTestReport;
+
+// The parts of a group runner's own work which show up in the trace.
+typedef enum scrSpanKind {
+    SCR_SPAN_SETUP = 0,
+    SCR_SPAN_CLEANUP,
+    SCR_SPAN_FORK,
+    SCR_SPAN_OUTPUT,
+
+    SCR_NUM_SPANS,
+} scrSpanKind;
+
+typedef struct scrEventSpan {
+    uint32_t kind;
+    pid_t pid;
+    double start; // CLOCK_MONOTONIC seconds.
+    double end;
+} scrEventSpan;
+
+// The parts of the framework's own work which are timed for every run.
+typedef enum scrPhase {
+    SCR_PHASE_FORK_RUNNER = 0,
+    SCR_PHASE_CAPTURE,
+    SCR_PHASE_FORK,
+    SCR_PHASE_REDIRECT,
+    SCR_PHASE_REPORT,
+    SCR_PHASE_SEND_OUTPUT,
+    SCR_PHASE_SHOW_RESULTS,
+
+    SCR_NUM_PHASES,
+} scrPhase;
+
+typedef struct scrOverhead {
+    unsigned long counts[SCR_NUM_PHASES];
+    double totals[SCR_NUM_PHASES]; // In seconds.
+} scrOverhead;
+
+typedef struct scrEventOutput {
+    size_t test_idx;
+    uint32_t stream;
+    uint32_t live; // Whether this is a line of streamed output rather than captured output.
+} scrEventOutput;
+
+// How much of each of a test's output streams is passed on to the reporters.
+#define SCR_EXCERPT_SIZE 4096
+
+typedef struct scrReportEntry {
+    const scrTest *test;
+    size_t group_idx;
+    scrTestCode result;
+    const char *reason; // How the test ended if it didn't simply return or call one of the SCR_ macros.
+    double duration;
+    bool cached;
+    const char *outputs[3]; // Excerpts of the test's output indexed by SCR_OUTPUT_*.  NULL if there was none.
+    size_t output_lengths[3];
+    bool truncated[3]; // Whether there was more output than the excerpt holds.
+} scrReportEntry;
+
+typedef struct scrEventReader {
+    const scrGroupStruct *group;
+    pid_t pid; // The group runner's.
+    int section; // The captured stream whose output is being shown or -1.
+    bool some_output;
+    bool greeted;
+    bool broken;  // Whether the stream stopped making sense, in which case the rest of it is discarded.
+    bool pending; // Whether report hasn't been passed to the reporters yet since its output might follow.
+    scrTestReport report;
+    size_t excerpt_lengths[3];
+    bool truncated[3];
+    char excerpts[3][SCR_EXCERPT_SIZE];
+    size_t length;
+    unsigned char buffer[2 * (sizeof(scrEventHeader) + sizeof(scrEventOutput) + SCR_EVENT_MAX_OUTPUT)];
+} scrEventReader;
+
+struct scrTestRun;
+
+typedef struct scrEventLoop scrEventLoop;
+
+typedef struct scrOutputStream {
+    const struct scrTestRun *run;
+    int fd;
+    unsigned int kind;
+    size_t partial_length;
+    char partial[256];
+} scrOutputStream;
+
+typedef struct scrTestRun {
+    const scrGroupStruct *group;
+    const scrTest *test;
+    scrEventLoop *loop;
+    pid_t child;
+    int command_fd;
+    int stdout_fd;
+    int stderr_fd;
+    int log_fd;
+    int status;
+    struct timespec start;
+    struct rusage rusage;
+    scrUsage usage;
+    scrBenchmarkResult *bench_result;
+    scrBatch *batch;
+    double *redirect_time; // How long the worker took to redirect its output, as measured by the worker.
+    size_t test_idx;
+    size_t batch_end;
+    size_t num_reported;
+    off_t output_starts[3];
+    scrCounters counters;
+    scrOutputStream streams[3];
+    unsigned int reaped : 1;
+    unsigned int idle : 1;
+    unsigned int streaming : 1;
+    unsigned int counting : 1;
+    unsigned int fail_fast : 1;
+#ifdef SCR_MONKEYPATCH
+    unsigned int have_patches : 1;
+#endif
+} scrTestRun;
+
+typedef bool
+scrStreamFn(void *arg);
+
+// The key that the entries of a store begin with.  A NULL name is for an entry about the group itself.
+typedef struct scrStoreKey {
+    size_t group_idx;
+    char *name;
+} scrStoreKey;
+
+// The entries of one of the files that persist between runs, like the baseline and the history.
+typedef struct scrStore {
+    gear entries;
+    size_t *slots; // Indices into entries plus one, hashed by their keys.  0 marks an empty slot.
+    size_t num_slots;
+} scrStore;
+
+// Adds the entry read from a line of a store's file.  Returns false if the line is malformed.
+typedef bool
+scrStoreParseFn(scrStore *store, char *line, void *arg);
+
+// Writes the contents of a store's file, including its header.
+typedef void
+scrStoreWriteFn(FILE *file);
+
 #ifndef ARRAY_LENGTH
 #define ARRAY_LENGTH(arr) (sizeof(arr) / sizeof((arr)[0]))
 #endif
 
+#if defined(ANDROID) || defined(__ANDROID__)
+#define SCR_TMP_PREFIX "/data/local"
+#else
+#define SCR_TMP_PREFIX
+#endif
+#define SCR_TEMPLATE(fmt) SCR_TMP_PREFIX "/tmp/scrutiny_" #fmt "_XXXXXX"
+
+// Where an FNV-1a hash starts before any bytes are folded into it.
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+
 #define GREEN       "\x1b[0;32m"
 #define YELLOW      "\x1b[0;33m"
 #define RED         "\x1b[0;31m"
 #define RESET_COLOR "\x1b[0m"
 
+void
+baselineFree(void);
+
+bool
+baselineLoad(const scrOptions *options);
+
+bool
+baselineRegressed(const scrTest *test, const scrTiming *timing);
+
+void
+baselineSave(const scrOptions *options);
+
+bool
+batchReport(scrTestRun *run, bool verbose, scrTestCode *result);
+
+void
+benchmarkDo(const scrTest *test, scrBenchmarkResult *result);
+
+void
+cacheFree(void);
+
+void
+cacheLoad(const scrOptions *options);
+
+void
+cacheSave(const scrOptions *options);
+
+void
+cacheSkip(const scrOptions *options, scrStats *stats);
+
+void
+captureFree(scrTestRun *run);
+
+bool
+captureInit(scrTestRun *run);
+
 pid_t
 cleanFork(void);
 
+bool
+countersProbe(void);
+
+void
+countersStart(scrCounters *counters, pid_t child);
+
+void
+countersStop(scrCounters *counters);
+
 void
 dumpFd(int fd, bool printable_only);
 
+void
+dumpFdRange(int fd, off_t start, off_t end, bool printable_only);
+
+void
+endResultLine(const scrUsage *usage);
+
+void
+eventOverhead(void);
+
+bool
+eventRead(scrEventReader *reader, int fd);
+
+void
+eventReaderFinish(scrEventReader *reader);
+
+void
+eventReaderInit(scrEventReader *reader, const scrGroupStruct *group, pid_t pid);
+
+void
+eventReplay(scrEventReader *reader, int fd);
+
+void
+eventSpan(scrSpanKind kind, double start);
+
+void
+eventTestFinished(const scrTest *test, scrTestReport *report);
+
+void
+eventTestOutput(const scrTest *test, unsigned int stream, bool live, const void *data, size_t length);
+
+void
+eventTestOutputRange(const scrTest *test, unsigned int stream, int fd, off_t start, off_t end);
+
+void
+eventTestStarted(const scrTest *test, pid_t pid);
+
+void
+eventsDetach(void);
+
+void
+eventsOpen(int fd, const scrOptions *options);
+
 int
-groupDo(const scrGroupStruct *group, const scrOptions *options, int error_fd, int pipe_fd);
+groupDo(const scrGroupStruct *group, const scrOptions *options, int error_fd);
 
 void
 groupFree(scrGroupStruct *group);
 
+uint64_t
+hashBytes(uint64_t hash, const void *data, size_t size);
+
+uint64_t
+hashTest(size_t group_idx, const char *name);
+
 void
-showTestResult(const scrTest *test, scrTestCode result);
+historyFree(void);
 
-scrTestCode
-testRun(const scrTest *test, bool verbose);
+void
+historyLoad(const scrOptions *options);
+
+bool
+historyLoaded(void);
 
 void
-setGroupCtx(void *ctx);
+historySave(const scrOptions *options);
+
+bool
+historyScheduleGroups(size_t *order);
+
+void
+historyScheduleTests(scrGroupStruct *group);
+
+unsigned int
+jobCount(unsigned int max_jobs);
+
+void
+journalFree(void);
+
+bool
+journalHasEntries(void);
+
+void
+journalLoad(const scrOptions *options);
+
+void
+journalNarrow(bool failed);
+
+size_t
+journalNumFailed(void);
+
+void
+journalSave(const scrOptions *options);
+
+void
+loopAddChild(scrEventLoop *loop, pid_t child, unsigned int timeout);
+
+void
+loopCatchTerm(const scrEventLoop *loop);
+
+scrEventLoop *
+loopCreate(unsigned int capacity);
+
+void
+loopDestroy(scrEventLoop *loop);
+
+void
+loopUnwatchStream(scrEventLoop *loop, int fd);
+
+pid_t
+loopWaitChild(scrEventLoop *loop, int *status, struct rusage *rusage, bool *timed_out);
+
+void
+loopWatchStream(scrEventLoop *loop, int fd, scrStreamFn *fn, void *arg);
+
+int
+makeTempFile(char *template);
+
+void
+mergeUsage(scrStats *stats, const scrUsage *total, const scrUsage *max);
+
+double
+monotonicNow(void);
+
+double
+overheadAdd(scrPhase phase, double start);
+
+void
+overheadAddTime(scrPhase phase, double seconds);
+
+void
+overheadMerge(const scrOverhead *other);
+
+void
+overheadReset(void);
+
+void
+overheadShow(const scrStats *stats);
+
+const scrOverhead *
+overheadTotals(void);
+
+void
+pruneTests(scrGroupStruct *group);
+
+void
+replaceNonPrintable(char *buffer, size_t size);
+
+bool
+reportersActive(void);
+
+void
+reportersAdd(const scrReportEntry *entry);
+
+void
+reportersClose(const scrStats *stats);
+
+bool
+reportersOpen(const scrOptions *options);
+
+bool
+selectTests(const scrOptions *options);
 
 void
+setExitPoint(jmp_buf *point);
+
+void
+setGroupCtx(void *ctx);
+
+int
 setLogFd(int fd);
 
 void
-waitForProcess(pid_t pid, unsigned int timeout, int *status, bool *timed_out);
+showBenchmarkResult(const scrTest *test, const scrBenchmarkResult *result);
+
+void
+showCachedResult(const scrTest *test);
+
+void
+showCounters(const scrTest *test, const scrCounters *counters);
+
+void
+showTestResult(const scrTest *test, scrTestCode result, const scrUsage *usage);
+
+void *
+storeAdd(scrStore *store, const void *entry);
+
+void *
+storeFind(const scrStore *store, size_t group_idx, const char *name);
+
+void
+storeFree(scrStore *store);
+
+void
+storeInit(scrStore *store, size_t entry_size);
+
+bool
+storeRead(scrStore *store, FILE *file, const char *header, scrStoreParseFn *parse_fn, void *arg);
+
+void
+storeWrite(const char *path, const char *what, scrStoreWriteFn *write_fn);
+
+void
+streamClose(scrTestRun *run, scrEventLoop *loop);
+
+void
+streamDetach(scrTestRun *run);
+
+bool
+streamOpen(scrTestRun *run);
+
+void
+streamWatch(scrTestRun *run, scrEventLoop *loop);
+
+scrTestCode
+testFinish(scrTestRun *run, int status, bool timed_out, bool verbose);
+
+scrTestCode
+testInline(scrTestRun *run, size_t test_idx, bool verbose);
+
+bool
+testPrefork(scrTestRun *run);
+
+void
+testRetire(scrTestRun *run);
+
+bool
+testStart(scrTestRun *run, size_t test_idx, size_t batch_length);
+
+bool
+traceActive(void);
+
+void
+traceClose(void);
+
+void
+traceNameProcess(pid_t pid, const char *name);
+
+bool
+traceOpen(const scrOptions *options);
+
+void
+traceSpan(pid_t pid, pid_t tid, const char *name, const char *category, double start, double end);
+
+void
+workerOverhead(scrTestRun *run);
+
+void
+writeJson(FILE *file, const char *string, size_t length);
 
 extern gear groups;
 extern bool show_color;
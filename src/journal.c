@@ -0,0 +1,222 @@
+#include <errno.h>
+#include <stdio.h>
+
+#include "internal.h"
+
+#define JOURNAL_HEADER "# scrutiny journal 1\n"
+
+typedef struct journalEntry {
+    scrStoreKey key;
+    scrTestCode result;
+    double duration;
+} journalEntry;
+
+static const char result_letters[] = {
+    [SCR_TEST_CODE_OK] = 'P',
+    [SCR_TEST_CODE_FAIL] = 'F',
+    [SCR_TEST_CODE_ERROR] = 'E',
+    [SCR_TEST_CODE_SKIP] = 'S',
+};
+
+static scrStore entries;
+static bool loaded;
+
+static bool
+parseResult(char letter, scrTestCode *result)
+{
+    for (unsigned int k = 0; k < ARRAY_LENGTH(result_letters); k++) {
+        if (result_letters[k] == letter) {
+            *result = k;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+parseEntry(scrStore *store, char *line, void *arg)
+{
+    journalEntry entry;
+    char letter;
+    int name_offset;
+    (void)arg;
+
+    if (sscanf(line, "%zu %c %lf %n", &entry.key.group_idx, &letter, &entry.duration, &name_offset) != 3 ||
+        !parseResult(letter, &entry.result)) {
+        return false;
+    }
+
+    entry.key.name = line + name_offset;
+    return storeAdd(store, &entry) != NULL;
+}
+
+void
+journalLoad(const scrOptions *options)
+{
+    FILE *file;
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    loaded = false;
+    if (!options->journal_file) {
+        return;
+    }
+
+    storeInit(&entries, sizeof(journalEntry));
+
+    file = fopen(options->journal_file, "r");
+    if (file) {
+        // Like the history, the journal only decides what runs first so a bad one is simply started over.
+        if (!storeRead(&entries, file, JOURNAL_HEADER, parseEntry, NULL)) {
+            fprintf(stderr, "Ignoring malformed journal file: %s\n", options->journal_file);
+            journalFree();
+            storeInit(&entries, sizeof(journalEntry));
+        }
+        fclose(file);
+    }
+    else if (errno != ENOENT) {
+        perror("fopen");
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            journalEntry *entry = storeFind(&entries, group_idx, test->name);
+
+            test->failed_before =
+                entry && (entry->result == SCR_TEST_CODE_FAIL || entry->result == SCR_TEST_CODE_ERROR);
+        }
+    }
+
+    loaded = true;
+}
+
+size_t
+journalNumFailed(void)
+{
+    scrGroupStruct *group;
+    size_t num_failed = 0;
+
+    if (!loaded) {
+        return 0;
+    }
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            num_failed += (test->selected && test->failed_before);
+        }
+    }
+
+    return num_failed;
+}
+
+bool
+journalHasEntries(void)
+{
+    return loaded && entries.entries.length > 0;
+}
+
+void
+journalNarrow(bool failed)
+{
+    scrGroupStruct *group;
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
+        group->num_selected = 0;
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            if (failed) {
+                // The rest of the selection is held back until the tests which failed last time have run.
+                test->deferred = (test->selected && !test->failed_before);
+                test->selected = (test->selected && test->failed_before);
+            }
+            else {
+                test->selected = test->deferred;
+                test->deferred = false;
+            }
+            group->num_selected += test->selected;
+        }
+    }
+}
+
+static bool
+updateEntries(void)
+{
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    // Tests which didn't run this time keep their entries so that they're still known to have failed.
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            const scrTestRecord *record = test->record;
+            journalEntry *entry, new_entry = {.key = {group_idx, test->name}};
+
+            // A test can have a result without having finished if its group runner died.
+            if (!record || (!record->finished && record->result == SCR_TEST_CODE_OK)) {
+                continue;
+            }
+
+            entry = storeFind(&entries, group_idx, test->name);
+            if (!entry) {
+                entry = storeAdd(&entries, &new_entry);
+                if (!entry) {
+                    return false;
+                }
+            }
+
+            entry->result = record->result;
+            entry->duration = record->finished ? record->usage.wall_time : 0;
+        }
+    }
+
+    return true;
+}
+
+static void
+writeEntries(FILE *file)
+{
+    journalEntry *entry;
+
+    fputs(JOURNAL_HEADER, file);
+    GEAR_FOR_EACH(&entries.entries, entry)
+    {
+        fprintf(file, "%zu %c %.6g %s\n", entry->key.group_idx, result_letters[entry->result],
+                entry->duration, entry->key.name);
+    }
+}
+
+void
+journalSave(const scrOptions *options)
+{
+    if (!loaded) {
+        return;
+    }
+
+    if (!updateEntries()) {
+        fprintf(stderr, "Failed to update the journal\n");
+        return;
+    }
+
+    storeWrite(options->journal_file, "journal", writeEntries);
+}
+
+void
+journalFree(void)
+{
+    storeFree(&entries);
+}
@@ -0,0 +1,551 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#if defined(SYS_pidfd_open) && !defined(SCR_NO_PIDFD)
+#define SCR_USE_PIDFD
+#endif
+
+struct waitChild {
+    pid_t pid;
+#ifdef SCR_USE_PIDFD
+    int pidfd;
+#endif
+    struct timespec deadline;
+    unsigned int has_deadline : 1;
+    unsigned int timed_out : 1;
+};
+
+struct streamWatch {
+    int fd;
+    scrStreamFn *fn;
+    void *arg;
+};
+
+struct scrEventLoop {
+    struct waitChild *children;
+    struct streamWatch *streams;
+    unsigned int length;
+    unsigned int num_streams;
+    unsigned int capacity;
+#ifdef SCR_USE_PIDFD
+    int epoll_fd;
+    int signal_fd;
+    int timer_fd;
+    struct timespec armed_deadline;
+    unsigned int timer_armed : 1;
+#endif
+};
+
+#define STREAMS_PER_CHILD 3
+
+static const scrEventLoop *term_loop;
+
+static bool
+timeBefore(const struct timespec *a, const struct timespec *b)
+{
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void
+killAllAndExit(const scrEventLoop *loop)
+{
+    for (unsigned int k = 0; k < loop->length; k++) {
+        kill(loop->children[k].pid, SIGKILL);
+    }
+    for (unsigned int k = 0; k < loop->length; k++) {
+        while (waitpid(loop->children[k].pid, NULL, 0) < 0) {}
+    }
+    _exit(1);
+}
+
+static void
+termHandler(int signum)
+{
+    (void)signum;
+    killAllAndExit(term_loop);
+}
+
+static bool
+checkDeadlines(scrEventLoop *loop, struct timespec *next_deadline)
+{
+    bool have_deadline = false;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (unsigned int k = 0; k < loop->length; k++) {
+        struct waitChild *child = &loop->children[k];
+
+        if (!child->has_deadline || child->timed_out) {
+            continue;
+        }
+
+        if (!timeBefore(&now, &child->deadline)) {
+            child->timed_out = true;
+            kill(child->pid, SIGKILL);
+        }
+        else if (!have_deadline || timeBefore(&child->deadline, next_deadline)) {
+            *next_deadline = child->deadline;
+            have_deadline = true;
+        }
+    }
+
+    return have_deadline;
+}
+
+static pid_t
+removeChild(scrEventLoop *loop, unsigned int idx, bool *timed_out)
+{
+    pid_t pid = loop->children[idx].pid;
+
+    *timed_out = loop->children[idx].timed_out;
+#ifdef SCR_USE_PIDFD
+    close(loop->children[idx].pidfd);
+#endif
+    loop->children[idx] = loop->children[--loop->length];
+    return pid;
+}
+
+static void
+dispatchStream(scrEventLoop *loop, int fd)
+{
+    for (unsigned int k = 0; k < loop->num_streams; k++) {
+        if (loop->streams[k].fd == fd) {
+            if (!loop->streams[k].fn(loop->streams[k].arg)) {
+                loopUnwatchStream(loop, fd);
+            }
+            return;
+        }
+    }
+}
+
+#ifdef SCR_USE_PIDFD
+
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+static bool
+watchFd(const scrEventLoop *loop, int fd)
+{
+    struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        perror("epoll_ctl");
+        return false;
+    }
+    return true;
+}
+
+static bool
+initEvents(scrEventLoop *loop)
+{
+    sigset_t signals;
+
+    loop->signal_fd = loop->timer_fd = -1;
+    loop->timer_armed = false;
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        perror("epoll_create1");
+        return false;
+    }
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    loop->signal_fd = signalfd(-1, &signals, SFD_CLOEXEC);
+    if (loop->signal_fd < 0) {
+        perror("signalfd");
+        return false;
+    }
+
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (loop->timer_fd < 0) {
+        perror("timerfd_create");
+        return false;
+    }
+
+    return watchFd(loop, loop->signal_fd) && watchFd(loop, loop->timer_fd);
+}
+
+static void
+freeEvents(scrEventLoop *loop)
+{
+    close(loop->epoll_fd);
+    close(loop->signal_fd);
+    close(loop->timer_fd);
+}
+
+static void
+armTimer(scrEventLoop *loop, const struct timespec *deadline)
+{
+    struct itimerspec timer = {0};
+
+    loop->timer_armed = (deadline != NULL);
+    if (deadline) {
+        timer.it_value = *deadline;
+        loop->armed_deadline = *deadline;
+    }
+
+    if (timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) != 0) {
+        perror("timerfd_settime");
+        killAllAndExit(loop);
+    }
+}
+
+static void
+watchChild(scrEventLoop *loop, struct waitChild *child)
+{
+    child->pidfd = syscall(SYS_pidfd_open, child->pid, 0);
+    if (child->pidfd < 0) {
+        perror("pidfd_open");
+        killAllAndExit(loop);
+    }
+
+    if (!watchFd(loop, child->pidfd)) {
+        killAllAndExit(loop);
+    }
+
+    if (child->has_deadline && (!loop->timer_armed || timeBefore(&child->deadline, &loop->armed_deadline))) {
+        armTimer(loop, &child->deadline);
+    }
+}
+
+static void
+watchStream(scrEventLoop *loop, int fd)
+{
+    if (!watchFd(loop, fd)) {
+        killAllAndExit(loop);
+    }
+}
+
+static void
+unwatchStream(scrEventLoop *loop, int fd)
+{
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+pid_t
+loopWaitChild(scrEventLoop *loop, int *status, struct rusage *rusage, bool *timed_out)
+{
+    while (1) {
+        int num_events;
+        bool timer_fired = false;
+        struct epoll_event events[16];
+
+        num_events = epoll_wait(loop->epoll_fd, events, ARRAY_LENGTH(events), -1);
+        if (num_events < 0) {
+            int local_errno = errno;
+
+            if (local_errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "epoll_wait: %s\n", strerror(local_errno));
+            killAllAndExit(loop);
+        }
+
+        for (int k = 0; k < num_events; k++) {
+            if (events[k].data.fd == loop->signal_fd) {
+                killAllAndExit(loop);
+            }
+            else if (events[k].data.fd == loop->timer_fd) {
+                timer_fired = true;
+            }
+            else {
+                dispatchStream(loop, events[k].data.fd);
+            }
+        }
+
+        if (timer_fired) {
+            uint64_t expirations;
+            struct timespec deadline;
+
+            if (read(loop->timer_fd, &expirations, sizeof(expirations)) < 0) {}
+            armTimer(loop, checkDeadlines(loop, &deadline) ? &deadline : NULL);
+        }
+
+        for (int k = 0; k < num_events; k++) {
+            for (unsigned int idx = 0; idx < loop->length; idx++) {
+                if (loop->children[idx].pidfd == events[k].data.fd) {
+                    while (wait4(loop->children[idx].pid, status, 0, rusage) < 0) {}
+                    return removeChild(loop, idx, timed_out);
+                }
+            }
+        }
+    }
+}
+
+#else  // SCR_USE_PIDFD
+
+#include <poll.h>
+
+// Without pidfds, there is no way to wait on both a child and a pipe at once so streams are polled.
+#define STREAM_POLL_MS 10
+
+static bool
+initEvents(scrEventLoop *loop)
+{
+    (void)loop;
+    return true;
+}
+
+static void
+freeEvents(scrEventLoop *loop)
+{
+    (void)loop;
+}
+
+static void
+watchChild(scrEventLoop *loop, struct waitChild *child)
+{
+    (void)loop;
+    (void)child;
+}
+
+static void
+watchStream(scrEventLoop *loop, int fd)
+{
+    (void)loop;
+    (void)fd;
+}
+
+static void
+unwatchStream(scrEventLoop *loop, int fd)
+{
+    (void)loop;
+    (void)fd;
+}
+
+static pid_t
+reapAny(scrEventLoop *loop, int *status, struct rusage *rusage, bool *timed_out)
+{
+    for (unsigned int k = 0; k < loop->length; k++) {
+        if (wait4(loop->children[k].pid, status, WNOHANG, rusage) == loop->children[k].pid) {
+            return removeChild(loop, k, timed_out);
+        }
+    }
+
+    return -1;
+}
+
+static void
+pollStreams(scrEventLoop *loop)
+{
+    unsigned int num_pollers = loop->num_streams;
+    struct pollfd pollers[num_pollers];
+
+    for (unsigned int k = 0; k < num_pollers; k++) {
+        pollers[k].fd = loop->streams[k].fd;
+        pollers[k].events = POLLIN;
+    }
+
+    if (poll(pollers, num_pollers, STREAM_POLL_MS) <= 0) {
+        return;
+    }
+
+    for (unsigned int k = 0; k < num_pollers; k++) {
+        if (pollers[k].revents) {
+            dispatchStream(loop, pollers[k].fd);
+        }
+    }
+}
+
+#if defined(_POSIX_REALTIME_SIGNALS) && _POSIX_REALTIME_SIGNALS > 0
+
+static void
+timeUntil(const struct timespec *deadline, struct timespec *remaining)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    remaining->tv_sec = deadline->tv_sec - now.tv_sec;
+    remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if (remaining->tv_nsec < 0) {
+        remaining->tv_sec--;
+        remaining->tv_nsec += 1000000000;
+    }
+    if (remaining->tv_sec < 0) {
+        remaining->tv_sec = remaining->tv_nsec = 0;
+    }
+}
+
+pid_t
+loopWaitChild(scrEventLoop *loop, int *status, struct rusage *rusage, bool *timed_out)
+{
+    sigset_t signals;
+
+    // The group runner blocks every signal so SIGCHLD and SIGTERM stay pending until we collect them here.
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGTERM);
+
+    while (1) {
+        pid_t child;
+        struct timespec deadline = {0}, remaining, *timeout = NULL;
+
+        child = reapAny(loop, status, rusage, timed_out);
+        if (child > 0) {
+            return child;
+        }
+
+        if (checkDeadlines(loop, &deadline)) {
+            timeUntil(&deadline, &remaining);
+            timeout = &remaining;
+        }
+
+        if (loop->num_streams > 0) {
+            pollStreams(loop);
+            remaining.tv_sec = remaining.tv_nsec = 0;
+            timeout = &remaining;
+        }
+
+        if (sigtimedwait(&signals, NULL, timeout) == SIGTERM) {
+            killAllAndExit(loop);
+        }
+    }
+}
+
+#else  // _POSIX_REALTIME_SIGNALS
+
+#define ONE_TENTH_SECOND 10000000
+
+static bool
+caughtSignal(void)
+{
+    sigset_t set;
+
+    sigpending(&set);
+    return sigismember(&set, SIGTERM);
+}
+
+pid_t
+loopWaitChild(scrEventLoop *loop, int *status, struct rusage *rusage, bool *timed_out)
+{
+    struct timespec deadline, lapse = {.tv_nsec = ONE_TENTH_SECOND};
+
+    while (1) {
+        pid_t child;
+
+        if (caughtSignal()) {
+            killAllAndExit(loop);
+        }
+
+        child = reapAny(loop, status, rusage, timed_out);
+        if (child > 0) {
+            return child;
+        }
+
+        if (loop->num_streams > 0) {
+            pollStreams(loop);
+        }
+        else {
+            nanosleep(&lapse, NULL);
+        }
+        checkDeadlines(loop, &deadline);
+    }
+}
+
+#endif  // _POSIX_REALTIME_SIGNALS
+
+#endif  // SCR_USE_PIDFD
+
+scrEventLoop *
+loopCreate(unsigned int capacity)
+{
+    scrEventLoop *loop;
+
+    loop = malloc(sizeof(*loop));
+    if (!loop) {
+        return NULL;
+    }
+
+    loop->children = calloc(capacity, sizeof(*loop->children));
+    loop->streams = calloc(capacity * STREAMS_PER_CHILD, sizeof(*loop->streams));
+    if (!loop->children || !loop->streams) {
+        free(loop->children);
+        free(loop->streams);
+        free(loop);
+        return NULL;
+    }
+    loop->length = loop->num_streams = 0;
+    loop->capacity = capacity;
+
+    if (!initEvents(loop)) {
+        loopDestroy(loop);
+        return NULL;
+    }
+
+    return loop;
+}
+
+void
+loopDestroy(scrEventLoop *loop)
+{
+    freeEvents(loop);
+    free(loop->children);
+    free(loop->streams);
+    free(loop);
+}
+
+void
+loopAddChild(scrEventLoop *loop, pid_t child, unsigned int timeout)
+{
+    struct waitChild *entry = &loop->children[loop->length++];
+
+    entry->pid = child;
+    entry->timed_out = false;
+    entry->has_deadline = (timeout > 0);
+    if (timeout > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &entry->deadline);
+        entry->deadline.tv_sec += timeout;
+    }
+
+    watchChild(loop, entry);
+}
+
+void
+loopWatchStream(scrEventLoop *loop, int fd, scrStreamFn *fn, void *arg)
+{
+    struct streamWatch *watch = &loop->streams[loop->num_streams++];
+
+    watch->fd = fd;
+    watch->fn = fn;
+    watch->arg = arg;
+
+    watchStream(loop, fd);
+}
+
+void
+loopUnwatchStream(scrEventLoop *loop, int fd)
+{
+    for (unsigned int k = 0; k < loop->num_streams; k++) {
+        if (loop->streams[k].fd == fd) {
+            unwatchStream(loop, fd);
+            loop->streams[k] = loop->streams[--loop->num_streams];
+            return;
+        }
+    }
+}
+
+// Until this is called again with NULL, a SIGTERM which is delivered rather than collected by the loop still
+// takes the loop's children down with the runner.
+void
+loopCatchTerm(const scrEventLoop *loop)
+{
+    struct sigaction action = {.sa_handler = loop ? termHandler : SIG_DFL};
+
+    sigfillset(&action.sa_mask);
+    term_loop = loop;
+    sigaction(SIGTERM, &action, NULL);
+}
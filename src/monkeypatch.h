@@ -8,6 +8,12 @@
 bool
 findFunction(const char *func_name, const char *file_substring, gear *got_entries);
 
+bool
+patchRunner(const gear *patch_goals, gear *originals);
+
+void
+unpatchRunner(gear *originals);
+
 #endif  // SCR_MONKEYPATCH
 
 #endif  // SCRUTINY_MONKEYPATCH_H
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "internal.h"
+
+static const char *const phase_names[] = {
+    [SCR_PHASE_FORK_RUNNER] = "fork group runner",
+    [SCR_PHASE_CAPTURE] = "capture files",
+    [SCR_PHASE_FORK] = "fork test process",
+    [SCR_PHASE_REDIRECT] = "redirect output",
+    [SCR_PHASE_REPORT] = "report result",
+    [SCR_PHASE_SEND_OUTPUT] = "send output",
+    [SCR_PHASE_SHOW_RESULTS] = "show results",
+};
+
+// Each group runner times its own work and sends the totals to the top-level process when it's done.
+static scrOverhead overhead;
+
+void
+overheadReset(void)
+{
+    memset(&overhead, 0, sizeof(overhead));
+}
+
+// Returns the time at which the phase ended.
+double
+overheadAdd(scrPhase phase, double start)
+{
+    double now = monotonicNow();
+
+    overheadAddTime(phase, now - start);
+    return now;
+}
+
+void
+overheadAddTime(scrPhase phase, double seconds)
+{
+    overhead.counts[phase]++;
+    overhead.totals[phase] += seconds;
+}
+
+void
+overheadMerge(const scrOverhead *other)
+{
+    for (unsigned int k = 0; k < SCR_NUM_PHASES; k++) {
+        overhead.counts[k] += other->counts[k];
+        overhead.totals[k] += other->totals[k];
+    }
+}
+
+const scrOverhead *
+overheadTotals(void)
+{
+    return &overhead;
+}
+
+void
+overheadShow(const scrStats *stats)
+{
+    unsigned int num_tests = stats->num_passed + stats->num_failed + stats->num_errored + stats->num_skipped -
+                             stats->num_cached;
+
+    printf("\nOverhead by phase:\n");
+    for (unsigned int k = 0; k < SCR_NUM_PHASES; k++) {
+        if (overhead.counts[k] == 0) {
+            continue;
+        }
+        printf("  %-18s %8lu x %9.1fus = %9.3fms\n", phase_names[k], overhead.counts[k],
+               overhead.totals[k] / overhead.counts[k] * 1e6, overhead.totals[k] * 1e3);
+    }
+    printf("  %-18s %8u x %9.1fus = %9.3fms\n", "per test", num_tests,
+           (num_tests > 0) ? stats->overhead_time / num_tests * 1e6 : 0, stats->overhead_time * 1e3);
+}
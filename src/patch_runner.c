@@ -0,0 +1,176 @@
+#include "monkeypatch.h"
+
+#ifdef SCR_MONKEYPATCH
+
+#include <linux/limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct mapping {
+    uintptr_t start;
+    uintptr_t end;
+    int prot;
+};
+
+struct savedEntry {
+    void **got_entry;
+    void *value;
+};
+
+static bool
+loadMappings(gear *mappings)
+{
+    FILE *file;
+    char line[PATH_MAX + 128];
+
+    file = fopen("/proc/self/maps", "r");
+    if (!file) {
+        perror("/proc/self/maps");
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        struct mapping mapping = {0};
+        unsigned long start, end;
+        char perms[5];
+
+        if (sscanf(line, "%lx-%lx %4s", &start, &end, perms) != 3) {
+            continue;
+        }
+        mapping.start = start;
+        mapping.end = end;
+        if (perms[0] == 'r') {
+            mapping.prot |= PROT_READ;
+        }
+        if (perms[1] == 'w') {
+            mapping.prot |= PROT_WRITE;
+        }
+        if (perms[2] == 'x') {
+            mapping.prot |= PROT_EXEC;
+        }
+
+        if (gearAppend(mappings, &mapping) != GEAR_RET_OK) {
+            exit(1);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static const struct mapping *
+findMapping(const gear *mappings, uintptr_t address)
+{
+    const struct mapping *mapping;
+
+    GEAR_FOR_EACH(mappings, mapping)
+    {
+        if (address >= mapping->start && address < mapping->end) {
+            return mapping;
+        }
+    }
+
+    return NULL;
+}
+
+// GOT entries in a RELRO segment are read-only by the time that main runs so their pages are made writable
+// just long enough to change them.
+static bool
+writeGotEntry(const gear *mappings, void **got_entry, void *value, void **old_value)
+{
+    uintptr_t address = (uintptr_t)got_entry, page;
+    long page_size = sysconf(_SC_PAGESIZE);
+    const struct mapping *mapping;
+
+    mapping = findMapping(mappings, address);
+    if (!mapping || !(mapping->prot & PROT_READ)) {
+        fprintf(stderr, "GOT entry %p isn't mapped\n", (void *)got_entry);
+        return false;
+    }
+
+    if (old_value) {
+        *old_value = *got_entry;
+    }
+    if (mapping->prot & PROT_WRITE) {
+        *got_entry = value;
+        return true;
+    }
+
+    page = address & ~(uintptr_t)(page_size - 1);
+    if (mprotect((void *)page, page_size, mapping->prot | PROT_WRITE) != 0) {
+        perror("mprotect");
+        return false;
+    }
+    *got_entry = value;
+    if (mprotect((void *)page, page_size, mapping->prot) != 0) {
+        perror("mprotect");
+        return false;
+    }
+
+    return true;
+}
+
+// Patches the group runner itself so that every process that it forks starts out patched.  The values that
+// are overwritten are saved in originals so that unpatchRunner can put them back.
+bool
+patchRunner(const gear *patch_goals, gear *originals)
+{
+    bool ok = true;
+    gear mappings;
+    scrPatchGoal *goal;
+
+    gearInit(originals, sizeof(struct savedEntry));
+    gearInit(&mappings, sizeof(struct mapping));
+    if (!loadMappings(&mappings)) {
+        return false;
+    }
+
+    GEAR_FOR_EACH(patch_goals, goal)
+    {
+        void **got_entry;
+
+        GEAR_FOR_EACH(&goal->got_entries, got_entry)
+        {
+            struct savedEntry saved = {.got_entry = *got_entry};
+
+            if (!writeGotEntry(&mappings, saved.got_entry, goal->func_ptr, &saved.value)) {
+                ok = false;
+                goto done;
+            }
+            if (gearAppend(originals, &saved) != GEAR_RET_OK) {
+                exit(1);
+            }
+        }
+    }
+
+done:
+    gearReset(&mappings);
+    if (!ok) {
+        unpatchRunner(originals);
+    }
+    return ok;
+}
+
+void
+unpatchRunner(gear *originals)
+{
+    gear mappings;
+
+    gearInit(&mappings, sizeof(struct mapping));
+    if (loadMappings(&mappings)) {
+        // Backwards, since an entry which was patched twice saved the first patch as its original value.
+        for (size_t k = originals->length; k > 0; k--) {
+            const struct savedEntry *saved = GEAR_GET_ITEM(originals, k - 1);
+
+            writeGotEntry(&mappings, saved->got_entry, saved->value, NULL);
+        }
+    }
+
+    gearReset(&mappings);
+    gearReset(originals);
+}
+
+#endif  // SCR_MONKEYPATCH
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "internal.h"
+
+typedef struct reporter {
+    void (*start)(struct reporter *reporter);
+    void (*add)(struct reporter *reporter, const scrReportEntry *entry);
+    void (*finish)(struct reporter *reporter, const scrStats *stats);
+    FILE *file;
+    long suite_offset;      // Where the JUnit testsuite tag starts.
+    unsigned int counts[4]; // The number of tests with each scrTestCode.
+    double total_time;
+} reporter;
+
+static const char *const output_names[] = {
+    [SCR_OUTPUT_STDOUT] = "stdout",
+    [SCR_OUTPUT_STDERR] = "stderr",
+    [SCR_OUTPUT_LOG] = "log",
+};
+
+static const char *const status_names[] = {
+    [SCR_TEST_CODE_OK] = "passed",
+    [SCR_TEST_CODE_FAIL] = "failed",
+    [SCR_TEST_CODE_ERROR] = "errored",
+    [SCR_TEST_CODE_SKIP] = "skipped",
+};
+
+static void
+writeXml(FILE *file, const char *string, size_t length)
+{
+    for (size_t k = 0; k < length; k++) {
+        unsigned char c = string[k];
+
+        switch (c) {
+        case '&': fputs("&amp;", file); break;
+        case '<': fputs("&lt;", file); break;
+        case '>': fputs("&gt;", file); break;
+        case '"': fputs("&quot;", file); break;
+        default:
+            // XML can't hold most control characters, even when escaped.
+            fputc((c < 0x20 && c != '\t' && c != '\n' && c != '\r') ? '?' : c, file);
+            break;
+        }
+    }
+}
+
+static void
+writeXmlOutput(FILE *file, const scrReportEntry *entry, unsigned int stream)
+{
+    writeXml(file, entry->outputs[stream], entry->output_lengths[stream]);
+    if (entry->truncated[stream]) {
+        fputs("\n[truncated]", file);
+    }
+}
+
+// Every count has a fixed width so that the real ones can be written over the placeholders at the end.
+static void
+writeSuiteTag(reporter *reporter)
+{
+    fprintf(reporter->file,
+            "  <testsuite name=\"scrutiny\" tests=\"%010u\" failures=\"%010u\" errors=\"%010u\" "
+            "skipped=\"%010u\" time=\"%014.3f\">\n",
+            reporter->counts[SCR_TEST_CODE_OK] + reporter->counts[SCR_TEST_CODE_FAIL] +
+                reporter->counts[SCR_TEST_CODE_ERROR] + reporter->counts[SCR_TEST_CODE_SKIP],
+            reporter->counts[SCR_TEST_CODE_FAIL], reporter->counts[SCR_TEST_CODE_ERROR],
+            reporter->counts[SCR_TEST_CODE_SKIP], reporter->total_time);
+}
+
+static void
+junitStart(reporter *reporter)
+{
+    fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", reporter->file);
+    reporter->suite_offset = ftell(reporter->file);
+    writeSuiteTag(reporter);
+}
+
+static void
+junitAdd(reporter *reporter, const scrReportEntry *entry)
+{
+    static const char *const elements[] = {
+        [SCR_TEST_CODE_FAIL] = "failure",
+        [SCR_TEST_CODE_ERROR] = "error",
+        [SCR_TEST_CODE_SKIP] = "skipped",
+    };
+    FILE *file = reporter->file;
+    const char *element = (entry->result == SCR_TEST_CODE_OK) ? NULL : elements[entry->result];
+    // The log says why a test failed, errored, or was skipped.  Otherwise, it's just more output.
+    bool log_in_element = element && entry->outputs[SCR_OUTPUT_LOG];
+
+    fprintf(file, "    <testcase classname=\"group%zu\" name=\"", entry->group_idx);
+    writeXml(file, entry->test->name, strlen(entry->test->name));
+    fprintf(file, "\" time=\"%.6f\">\n", entry->duration);
+
+    if (element) {
+        fprintf(file, "      <%s message=\"", element);
+        if (entry->reason) {
+            writeXml(file, entry->reason, strlen(entry->reason));
+        }
+        else {
+            fputs(status_names[entry->result], file);
+        }
+        fputs("\">", file);
+        if (log_in_element) {
+            writeXmlOutput(file, entry, SCR_OUTPUT_LOG);
+        }
+        fprintf(file, "</%s>\n", element);
+    }
+
+    if ((entry->outputs[SCR_OUTPUT_LOG] && !log_in_element) || entry->outputs[SCR_OUTPUT_STDOUT]) {
+        fputs("      <system-out>", file);
+        if (entry->outputs[SCR_OUTPUT_LOG] && !log_in_element) {
+            writeXmlOutput(file, entry, SCR_OUTPUT_LOG);
+        }
+        if (entry->outputs[SCR_OUTPUT_STDOUT]) {
+            writeXmlOutput(file, entry, SCR_OUTPUT_STDOUT);
+        }
+        fputs("</system-out>\n", file);
+    }
+    if (entry->outputs[SCR_OUTPUT_STDERR]) {
+        fputs("      <system-err>", file);
+        writeXmlOutput(file, entry, SCR_OUTPUT_STDERR);
+        fputs("</system-err>\n", file);
+    }
+
+    fputs("    </testcase>\n", file);
+
+    reporter->counts[entry->result]++;
+    reporter->total_time += entry->duration;
+}
+
+static void
+junitFinish(reporter *reporter, const scrStats *stats)
+{
+    (void)stats;
+
+    fputs("  </testsuite>\n</testsuites>\n", reporter->file);
+    if (reporter->suite_offset >= 0 && fseek(reporter->file, reporter->suite_offset, SEEK_SET) == 0) {
+        writeSuiteTag(reporter);
+    }
+}
+
+static void
+jsonAdd(reporter *reporter, const scrReportEntry *entry)
+{
+    FILE *file = reporter->file;
+
+    fprintf(file, "{\"type\":\"test\",\"group\":%zu,\"name\":", entry->group_idx);
+    writeJson(file, entry->test->name, strlen(entry->test->name));
+    fprintf(file, ",\"status\":\"%s\",\"duration\":%.6f,\"cached\":%s", status_names[entry->result],
+            entry->duration, entry->cached ? "true" : "false");
+    if (entry->reason) {
+        fputs(",\"reason\":", file);
+        writeJson(file, entry->reason, strlen(entry->reason));
+    }
+
+    for (unsigned int k = 0; k < ARRAY_LENGTH(output_names); k++) {
+        if (!entry->outputs[k]) {
+            continue;
+        }
+        fprintf(file, ",\"%s\":", output_names[k]);
+        writeJson(file, entry->outputs[k], entry->output_lengths[k]);
+        if (entry->truncated[k]) {
+            fprintf(file, ",\"%s_truncated\":true", output_names[k]);
+        }
+    }
+    fputs("}\n", file);
+}
+
+static void
+jsonFinish(reporter *reporter, const scrStats *stats)
+{
+    fprintf(reporter->file,
+            "{\"type\":\"summary\",\"passed\":%u,\"skipped\":%u,\"failed\":%u,\"errored\":%u,\"cached\":%u,"
+            "\"group_errors\":%u,\"wall_time\":%.6f,\"user_time\":%.6f,\"system_time\":%.6f,"
+            "\"overhead_time\":%.6f}\n",
+            stats->num_passed, stats->num_skipped, stats->num_failed, stats->num_errored, stats->num_cached,
+            stats->num_group_errors, stats->total_usage.wall_time, stats->total_usage.user_time,
+            stats->total_usage.system_time, stats->overhead_time);
+}
+
+static reporter reporters[] = {
+    {.start = junitStart, .add = junitAdd, .finish = junitFinish},
+    {.add = jsonAdd, .finish = jsonFinish},
+};
+
+static bool active;
+
+bool
+reportersOpen(const scrOptions *options)
+{
+    const char *paths[] = {options->junit_file, options->jsonl_file};
+
+    active = false;
+    for (unsigned int k = 0; k < ARRAY_LENGTH(reporters); k++) {
+        reporter *reporter = &reporters[k];
+
+        memset(reporter->counts, 0, sizeof(reporter->counts));
+        reporter->total_time = 0;
+        reporter->file = NULL;
+        if (!paths[k]) {
+            continue;
+        }
+
+        reporter->file = fopen(paths[k], "w");
+        if (!reporter->file) {
+            perror(paths[k]);
+            reportersClose(NULL);
+            return false;
+        }
+        if (reporter->start) {
+            reporter->start(reporter);
+        }
+        active = true;
+    }
+
+    return true;
+}
+
+bool
+reportersActive(void)
+{
+    return active;
+}
+
+void
+reportersAdd(const scrReportEntry *entry)
+{
+    for (unsigned int k = 0; k < ARRAY_LENGTH(reporters); k++) {
+        if (reporters[k].file) {
+            reporters[k].add(&reporters[k], entry);
+        }
+    }
+}
+
+// If stats is NULL, then the files are closed without being finished.
+void
+reportersClose(const scrStats *stats)
+{
+    for (unsigned int k = 0; k < ARRAY_LENGTH(reporters); k++) {
+        reporter *reporter = &reporters[k];
+
+        if (!reporter->file) {
+            continue;
+        }
+
+        if (stats) {
+            reporter->finish(reporter, stats);
+        }
+        if (fclose(reporter->file) != 0) {
+            perror("Failed to write a report");
+        }
+        reporter->file = NULL;
+    }
+    active = false;
+}
@@ -1,10 +1,14 @@
+#include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "internal.h"
@@ -12,6 +16,8 @@
 
 gear groups;
 static const int kill_signals[] = {SIGHUP, SIGQUIT, SIGTERM, SIGINT};
+static scrTestRecord *records;
+static size_t num_records;
 
 static void
 signalHandler(int signum)
@@ -33,117 +39,504 @@ removeSignalHandler(void)
 }
 
 static bool
-receiveStats(int pipe_fd, const scrGroupStruct *group, scrStats *stats)
+countResult(scrTestCode result, scrStats *stats)
 {
-    bool were_failures;
-    ssize_t transmitted;
-    scrStats stats_obj;
+    switch (result) {
+    case SCR_TEST_CODE_OK: stats->num_passed++; return false;
+    case SCR_TEST_CODE_SKIP: stats->num_skipped++; return false;
+    case SCR_TEST_CODE_FAIL: stats->num_failed++; return true;
+    default: stats->num_errored++; return true;
+    }
+}
+
+// Counts what the group runner recorded for each of its tests.  The tests that it never got to are given
+// unfinished_result unless the runner recorded that SCR_RF_FAIL_FAST stopped it before them.
+static bool
+collectResults(const scrGroupStruct *group, scrTestCode unfinished_result, scrStats *stats,
+               size_t *num_unfinished)
+{
+    bool were_failures = false;
     scrTest *test;
 
-    transmitted = read(pipe_fd, &stats_obj, sizeof(stats_obj));
-    if (transmitted < (ssize_t)sizeof(stats_obj)) {
-        if (transmitted < 0) {
-            perror("read");
+    *num_unfinished = 0;
+    GEAR_FOR_EACH(&group->tests, test)
+    {
+        scrTestRecord *record = test->record;
+
+        if (!test->selected) {
+            continue;
         }
-        else {
-            fprintf(stderr, "Failed to communicate with group runner\n");
+
+        if (record->finished) {
+            were_failures = countResult(record->result, stats) || were_failures;
+            mergeUsage(stats, &record->usage, &record->usage);
         }
-        stats->num_errored += group->tests.length;
-        GEAR_FOR_EACH(&group->tests, test)
-        {
-            showTestResult(test, SCR_TEST_CODE_ERROR);
+        else if (!record->stopped) {
+            scrReportEntry entry = {.test = test, .group_idx = group->idx, .result = unfinished_result};
+
+            // The journal still needs to know how the test ended up.
+            record->result = unfinished_result;
+            were_failures = countResult(unfinished_result, stats) || were_failures;
+            showTestResult(test, unfinished_result, NULL);
+            entry.reason = (unfinished_result == SCR_TEST_CODE_SKIP) ? "The group was skipped" :
+                                                                       "The group runner stopped first";
+            reportersAdd(&entry);
+            (*num_unfinished)++;
         }
-
-        were_failures = true;
-    }
-    else {
-        stats->num_passed += stats_obj.num_passed;
-        stats->num_skipped += stats_obj.num_skipped;
-        stats->num_failed += stats_obj.num_failed;
-        stats->num_errored += stats_obj.num_errored;
-
-        were_failures = (stats_obj.num_failed > 0 || stats_obj.num_errored > 0);
     }
 
     return were_failures;
 }
 
-static bool
-groupRun(const scrGroupStruct *group, const scrOptions *options, scrStats *stats)
+struct groupRunner {
+    scrGroupStruct *group;
+    pid_t pid;
+    int error_fd;
+    int output_fd;
+    int event_fd;
+    int replay_fd; // Where the events are held until the group finishes or -1 if they're shown right away.
+    struct timespec start;
+    scrEventReader reader;
+};
+
+static double
+timespecSeconds(const struct timespec *time)
 {
-    bool were_failures;
-    int status, exit_code;
-    pid_t child;
-    int fds[2], error_fds[2];
-    scrTest *test;
+    return time->tv_sec + time->tv_nsec / 1e9;
+}
 
-    if (group->tests.length == 0) {
-        return true;
-    }
+static double
+secondsSince(const struct timespec *start)
+{
+    struct timespec now;
 
-    if (pipe(fds) != 0 || pipe(error_fds) != 0) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void
+groupStart(scrGroupStruct *group, const scrOptions *options, bool capture_output, struct groupRunner *runner)
+{
+    int exit_code, error_fds[2], event_fds[2];
+    double end;
+    char output_template[] = SCR_TEMPLATE(group), replay_template[] = SCR_TEMPLATE(events);
+
+    runner->group = group;
+    runner->output_fd = runner->replay_fd = -1;
+
+    if (pipe(error_fds) != 0 || pipe(event_fds) != 0) {
         perror("pipe");
         exit(1);
     }
 
-    child = cleanFork();
-    switch (child) {
+    // With several groups running at once, each one's output is shown in one piece when it finishes.
+    if (capture_output) {
+        runner->output_fd = makeTempFile(output_template);
+        runner->replay_fd = makeTempFile(replay_template);
+        if (runner->output_fd < 0 || runner->replay_fd < 0) {
+            exit(1);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &runner->start);
+    runner->pid = cleanFork();
+    switch (runner->pid) {
     case -1: perror("fork"); exit(1);
     case 0:
-        close(fds[0]);
         close(error_fds[0]);
+        close(event_fds[0]);
         removeSignalHandler();
-        _exit(groupDo(group, options, error_fds[1], fds[1]));
+        overheadReset();
+        eventsOpen(event_fds[1], options);
+        pruneTests(group);
+        if (historyLoaded() && jobCount(group->max_jobs) > 1) {
+            historyScheduleTests(group);
+        }
+        if (capture_output && dup2(runner->output_fd, STDOUT_FILENO) < 0) {
+            perror("dup2");
+            _exit(SCR_TEST_CODE_ERROR);
+        }
+        exit_code = groupDo(group, options, error_fds[1]);
+        eventOverhead();
+        fflush(stdout);
+        _exit(exit_code);
     default: break;
     }
 
-    close(fds[1]);
     close(error_fds[1]);
+    close(event_fds[1]);
+    runner->error_fd = error_fds[0];
+    runner->event_fd = event_fds[0];
+    eventReaderInit(&runner->reader, group, runner->pid);
+    end = overheadAdd(SCR_PHASE_FORK_RUNNER, timespecSeconds(&runner->start));
+
+    if (traceActive()) {
+        char name[64];
+
+        traceSpan(getpid(), getpid(), "fork group runner", "overhead", timespecSeconds(&runner->start), end);
+        snprintf(name, sizeof(name), "group %zu", group->idx);
+        traceNameProcess(runner->pid, name);
+    }
+}
+
+// Returns false once the group runner has closed its end of the event stream.
+static bool
+groupReceive(struct groupRunner *runner)
+{
+    ssize_t transmitted;
+    char buffer[4096];
+
+    if (runner->replay_fd < 0) {
+        double start = monotonicNow();
+        bool open = eventRead(&runner->reader, runner->event_fd);
+
+        overheadAdd(SCR_PHASE_SHOW_RESULTS, start);
+        return open;
+    }
+
+    transmitted = read(runner->event_fd, buffer, sizeof(buffer));
+    if (transmitted <= 0) {
+        return transmitted < 0 && errno == EINTR;
+    }
+    if (write(runner->replay_fd, buffer, transmitted) != transmitted) {
+        perror("write");
+    }
+    return true;
+}
+
+static bool
+groupFinish(struct groupRunner *runner, int status, const scrOptions *options, scrStats *stats)
+{
+    bool were_failures, runner_failed;
+    int exit_code;
+    scrTestCode unfinished_result;
+    size_t num_unfinished;
+    scrGroupStruct *group = runner->group;
+    double start = monotonicNow(), end;
+
+    // A group which only ran some of its tests says nothing about how long the whole group takes.
+    if (WIFEXITED(status) && group->num_selected == group->tests.length) {
+        group->run_time = secondsSince(&runner->start);
+    }
+
+    if (runner->output_fd >= 0) {
+        dumpFd(runner->output_fd, false);
+        close(runner->output_fd);
+    }
+    if (runner->replay_fd >= 0) {
+        eventReplay(&runner->reader, runner->replay_fd);
+        close(runner->replay_fd);
+    }
+    eventReaderFinish(&runner->reader);
+    close(runner->event_fd);
+    end = overheadAdd(SCR_PHASE_SHOW_RESULTS, start);
+
+    if (traceActive()) {
+        char name[64];
 
-    while (waitpid(child, &status, 0) < 0) {}
+        snprintf(name, sizeof(name), "group %zu", group->idx);
+        traceSpan(runner->pid, runner->pid, name, "group", timespecSeconds(&runner->start), start);
+        traceSpan(getpid(), getpid(), "show output", "overhead", start, end);
+    }
 
     exit_code = WEXITSTATUS(status);
 
     if (WIFSIGNALED(status)) {
-        were_failures = true;
         fprintf(stderr, "Group runner was terminated by a signal: %i\n", WTERMSIG(status));
-        stats->num_errored += group->tests.length;
-        GEAR_FOR_EACH(&group->tests, test)
-        {
-            showTestResult(test, SCR_TEST_CODE_ERROR);
-        }
+        unfinished_result = SCR_TEST_CODE_ERROR;
     }
     else if (exit_code == SCR_TEST_CODE_SKIP) {
-        were_failures = false;
-        stats->num_skipped += group->tests.length;
-        GEAR_FOR_EACH(&group->tests, test)
-        {
-            showTestResult(test, SCR_TEST_CODE_SKIP);
+        unfinished_result = exit_code;
+    }
+    else if (exit_code == SCR_TEST_CODE_OK) {
+        // Something like a call to exit in create_fn or in an inline test.
+        unfinished_result = SCR_TEST_CODE_ERROR;
+    }
+    else {
+        if (exit_code != SCR_TEST_CODE_FAIL) {
+            fprintf(stderr, "Group runner exited with an error\n");
         }
+        unfinished_result = (exit_code == SCR_TEST_CODE_FAIL) ? SCR_TEST_CODE_FAIL : SCR_TEST_CODE_ERROR;
+        dumpFd(runner->error_fd, false);
+    }
+    close(runner->error_fd);
+    runner_failed = WIFSIGNALED(status) || (exit_code != SCR_TEST_CODE_OK && exit_code != SCR_TEST_CODE_SKIP);
+
+    were_failures = collectResults(group, unfinished_result, stats, &num_unfinished);
+    if (!runner_failed && unfinished_result == SCR_TEST_CODE_ERROR && num_unfinished > 0) {
+        fprintf(stderr, "Group runner exited before all of its tests had finished\n");
     }
-    else if (exit_code != SCR_TEST_CODE_OK) {
+
+    // If every test had already finished, then the runner must have failed in the group's cleanup.
+    if (runner_failed && num_unfinished == 0) {
+        fprintf(stderr, "The group runner failed after all of its tests had finished\n");
+        stats->num_group_errors++;
         were_failures = true;
-        if (exit_code == SCR_TEST_CODE_FAIL) {
-            stats->num_failed += group->tests.length;
+    }
+
+    return !(were_failures && (options->flags & SCR_RF_FAIL_FAST));
+}
+
+static void
+showRemaining(const struct groupRunner *runners, unsigned int num_jobs, const size_t *order,
+              size_t next_group)
+{
+    double total = 0, longest = 0;
+    unsigned int num_unknown = 0;
+
+    for (size_t k = next_group; k < groups.length; k++) {
+        const scrGroupStruct *group = GEAR_GET_ITEM(&groups, order ? order[k] : k);
+
+        if (group->num_selected == 0) {
+            continue;
         }
-        else {
-            fprintf(stderr, "Group runner exited with an error\n");
-            stats->num_errored += group->tests.length;
+        if (group->expected_time < 0) {
+            num_unknown++;
+            continue;
         }
+        total += group->expected_time;
+        if (group->expected_time > longest) {
+            longest = group->expected_time;
+        }
+    }
+
+    for (unsigned int k = 0; k < num_jobs; k++) {
+        const scrGroupStruct *group = runners[k].group;
+        double left;
+
+        if (!group) {
+            continue;
+        }
+        if (group->expected_time < 0) {
+            num_unknown++;
+            continue;
+        }
+        left = group->expected_time - secondsSince(&runners[k].start);
+        if (left > 0) {
+            total += left;
+            if (left > longest) {
+                longest = left;
+            }
+        }
+    }
+
+    if (total == 0 && num_unknown > 0) {
+        // There's nothing to base an estimate on yet.
+        return;
+    }
+
+    // The jobs can't finish any sooner than the longest group does.
+    if (total / num_jobs > longest) {
+        longest = total / num_jobs;
+    }
+
+    printf("Estimated time remaining: %.1fs", longest);
+    if (num_unknown > 0) {
+        printf(" plus %u group(s) without any history", num_unknown);
+    }
+    printf("\n");
+}
+
+static void
+runGroups(const scrOptions *options, scrStats *stats)
+{
+    bool keep_going = true;
+    unsigned int num_jobs, num_running = 0;
+    size_t next_group = 0, *order = NULL;
+    struct groupRunner *runners, **polled;
+    struct pollfd *poll_fds;
+
+    num_jobs = jobCount(options->max_jobs);
+    if (num_jobs > groups.length) {
+        num_jobs = groups.length;
+    }
+
+    runners = calloc(num_jobs, sizeof(*runners));
+    polled = malloc(sizeof(*polled) * num_jobs);
+    poll_fds = malloc(sizeof(*poll_fds) * num_jobs);
+    if (!runners || !polled || !poll_fds) {
+        exit(1);
+    }
+
+    // With several jobs, starting the longest groups first keeps a straggler from setting the total time.
+    if (historyLoaded() && num_jobs > 1) {
+        order = malloc(sizeof(*order) * groups.length);
+        if (order && !historyScheduleGroups(order)) {
+            free(order);
+            order = NULL;
+        }
+    }
+
+    if (historyLoaded()) {
+        showRemaining(runners, num_jobs, order, next_group);
+    }
+
+    while (1) {
+        unsigned int num_polled;
+
+        while (keep_going && num_running < num_jobs && next_group < groups.length) {
+            scrGroupStruct *group = GEAR_GET_ITEM(&groups, order ? order[next_group] : next_group);
+            unsigned int slot;
+
+            next_group++;
+
+            if (group->num_selected == 0) {
+                continue;
+            }
+
+            for (slot = 0; runners[slot].group; slot++) {}
+            groupStart(group, options, num_jobs > 1 && !(options->flags & SCR_RF_STREAM), &runners[slot]);
+            num_running++;
+        }
+
+        if (num_running == 0) {
+            break;
+        }
+
+        num_polled = 0;
+        for (unsigned int k = 0; k < num_jobs; k++) {
+            if (runners[k].group) {
+                poll_fds[num_polled].fd = runners[k].event_fd;
+                poll_fds[num_polled].events = POLLIN;
+                polled[num_polled++] = &runners[k];
+            }
+        }
+
+        if (poll(poll_fds, num_polled, -1) < 0) {
+            if (errno != EINTR) {
+                perror("poll");
+                exit(1);
+            }
+            continue;
+        }
+
+        for (unsigned int k = 0; k < num_polled; k++) {
+            struct groupRunner *runner = polled[k];
+            int status;
+
+            if (!poll_fds[k].revents || groupReceive(runner)) {
+                continue;
+            }
+
+            // The stream only ends when the group runner exits.
+            while (waitpid(runner->pid, &status, 0) < 0 && errno == EINTR) {}
+            if (!groupFinish(runner, status, options, stats)) {
+                keep_going = false;
+            }
+            runner->group = NULL;
+            num_running--;
+            if (historyLoaded() && keep_going && (num_running > 0 || next_group < groups.length)) {
+                showRemaining(runners, num_jobs, order, next_group);
+            }
+        }
+    }
+
+    free(order);
+    free(poll_fds);
+    free(polled);
+    free(runners);
+}
+
+static unsigned int
+numProblems(const scrStats *stats)
+{
+    return stats->num_failed + stats->num_errored;
+}
+
+static void
+runPhases(const scrOptions *options, scrStats *stats)
+{
+    unsigned int modes = options->flags & (SCR_RF_FAILED_FIRST | SCR_RF_FAILED_ONLY | SCR_RF_FAILED_GATE);
+    unsigned int num_problems;
+    size_t num_failed;
+
+    num_failed = modes ? journalNumFailed() : 0;
+    if (num_failed == 0) {
+        if ((modes & SCR_RF_FAILED_ONLY) && journalHasEntries()) {
+            printf("No tests failed last time\n");
+            return;
+        }
+        runGroups(options, stats);
+        return;
+    }
+
+    printf("Running %zu test(s) which failed last time%s\n\n", num_failed,
+           (modes & SCR_RF_FAILED_ONLY) ? "" : " first");
+    journalNarrow(true);
+    num_problems = numProblems(stats);
+    runGroups(options, stats);
+
+    if (modes & SCR_RF_FAILED_ONLY) {
+        return;
+    }
+    if (numProblems(stats) > num_problems && (options->flags & (SCR_RF_FAILED_GATE | SCR_RF_FAIL_FAST))) {
+        printf("\nNot running the remaining tests since some of them are still failing\n");
+        return;
+    }
+
+    printf("\nRunning the remaining tests\n\n");
+    journalNarrow(false);
+    runGroups(options, stats);
+}
+
+static bool
+recordsCreate(void)
+{
+    scrGroupStruct *group;
+    size_t idx = 0;
+
+    num_records = 0;
+    GEAR_FOR_EACH(&groups, group)
+    {
+        num_records += group->tests.length;
+    }
+    if (num_records == 0) {
+        return true;
+    }
+
+    // The group runners fill in the records as their tests finish and that's how their results get back here.
+    records =
+        mmap(NULL, num_records * sizeof(*records), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (records == MAP_FAILED) {
+        perror("mmap");
+        records = NULL;
+        return false;
+    }
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
         GEAR_FOR_EACH(&group->tests, test)
         {
-            showTestResult(test, exit_code);
+            test->record = &records[idx++];
         }
-        dumpFd(error_fds[0], false);
     }
-    else {
-        were_failures = receiveStats(fds[0], group, stats);
+
+    return true;
+}
+
+static void
+recordsFree(void)
+{
+    scrGroupStruct *group;
+
+    if (!records) {
+        return;
     }
 
-    close(fds[0]);
-    close(error_fds[0]);
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            test->record = NULL;
+        }
+    }
 
-    return !(were_failures && (options->flags & SCR_RF_FAIL_FAST));
+    munmap(records, num_records * sizeof(*records));
+    records = NULL;
 }
 
 static void
@@ -161,7 +554,7 @@ freeResources(void)
 scrGroup
 scrGroupCreate(scrCtxCreateFn create_fn, scrCtxCleanupFn cleanup_fn)
 {
-    scrGroupStruct group = {.create_fn = create_fn, .cleanup_fn = cleanup_fn};
+    scrGroupStruct group = {.create_fn = create_fn, .cleanup_fn = cleanup_fn, .max_jobs = 1};
 
     if (groups.item_size == 0) {
         struct sigaction action = {.sa_handler = signalHandler};
@@ -175,6 +568,7 @@ scrGroupCreate(scrCtxCreateFn create_fn, scrCtxCleanupFn cleanup_fn)
         }
     }
 
+    group.idx = groups.length;
     gearInit(&group.tests, sizeof(scrTest));
     gearSetExpansion(&group.tests, 5, 10);
 
@@ -194,12 +588,14 @@ scrRun(const scrOptions *options, scrStats *stats)
 {
     scrStats stats_obj;
     const scrOptions options_obj = {0};
-    scrGroupStruct *group;
+    scrOptions options_copy;
+    const char *failure;
 
     if (!stats) {
         stats = &stats_obj;
     }
     memset(stats, 0, sizeof(*stats));
+    overheadReset();
 
     printf("Scrutiny %s\n\n", SCRUTINY_VERSION);
 
@@ -213,13 +609,55 @@ scrRun(const scrOptions *options, scrStats *stats)
 
     show_color = isatty(STDOUT_FILENO);
 
-    GEAR_FOR_EACH(&groups, group)
-    {
-        if (!groupRun(group, options, stats)) {
-            break;
-        }
+    if ((options->flags & SCR_RF_COUNTERS) && !countersProbe()) {
+        memcpy(&options_copy, options, sizeof(options_copy));
+        options_copy.flags &= ~SCR_RF_COUNTERS;
+        options = &options_copy;
     }
 
+    // The causes have already been printed to stderr by the time that the run is abandoned.
+    if (!baselineLoad(options)) {
+        failure = "load the baseline";
+        goto abandon;
+    }
+    if (!recordsCreate()) {
+        failure = "allocate the test records";
+        goto abandon;
+    }
+    historyLoad(options);
+    journalLoad(options);
+    cacheLoad(options);
+    if (!selectTests(options)) {
+        failure = "select the tests";
+        goto abandon;
+    }
+    if (!reportersOpen(options)) {
+        failure = "open the reports";
+        goto abandon;
+    }
+    if (!traceOpen(options)) {
+        failure = "open the trace";
+        goto abandon;
+    }
+
+    cacheSkip(options, stats);
+    runPhases(options, stats);
+    for (unsigned int k = 0; k < SCR_NUM_PHASES; k++) {
+        stats->overhead_time += overheadTotals()->totals[k];
+    }
+    reportersClose(stats);
+    traceClose();
+
+    cacheSave(options);
+    cacheFree();
+    journalSave(options);
+    journalFree();
+    historySave(options);
+    historyFree();
+    baselineSave(options);
+    baselineFree();
+    recordsFree();
+
 show_summary:
     printf("\n\nTests run: %u\n",
            stats->num_passed + stats->num_failed + stats->num_errored + stats->num_skipped);
@@ -227,6 +665,27 @@ show_summary:
     printf("Skipped: %u\n", stats->num_skipped);
     printf("Failed: %u\n", stats->num_failed);
     printf("Errored: %u\n", stats->num_errored);
+    if (stats->num_cached > 0) {
+        printf("Cached: %u\n", stats->num_cached);
+    }
+    if (stats->num_group_errors > 0) {
+        printf("Group errors: %u\n", stats->num_group_errors);
+    }
+    printf("Test time: %.3fs total, %.3fs max\n", stats->total_usage.wall_time, stats->max_usage.wall_time);
+    printf("CPU time: %.3fs user, %.3fs sys\n", stats->total_usage.user_time, stats->total_usage.system_time);
+    if (options && (options->flags & SCR_RF_OVERHEAD)) {
+        overheadShow(stats);
+    }
 
-    return (stats->num_failed > 0 || stats->num_errored > 0);
+    return (stats->num_failed > 0 || stats->num_errored > 0 || stats->num_group_errors > 0);
+
+abandon:
+    reportersClose(NULL);
+    cacheFree();
+    journalFree();
+    historyFree();
+    baselineFree();
+    recordsFree();
+    printf("Failed to %s so no tests were run\n", failure);
+    return 1;
 }
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -12,25 +13,16 @@
 
 #include "internal.h"
 
-struct testParams {
-    int stdout_fd;
-    int stderr_fd;
-    int log_fd;
-#ifdef SCR_MONKEYPATCH
-    unsigned int have_patches : 1;
-#endif
-};
-
 #ifdef SCR_MONKEYPATCH
 
 #include <sys/ptrace.h>
 
 static bool
-applyPatches(pid_t child, const gear *patch_goals, int *status)
+applyPatches(pid_t child, const gear *patch_goals, int *status, struct rusage *rusage)
 {
     scrPatchGoal *goal;
 
-    while (waitpid(child, status, 0) < 0) {}
+    while (wait4(child, status, 0, rusage) < 0) {}
 
     if (!WIFSTOPPED(*status)) {
         return false;
@@ -46,8 +38,7 @@ applyPatches(pid_t child, const gear *patch_goals, int *status)
                 perror("ptrace (POKEDATA)");
                 kill(child, SIGKILL);
                 ptrace(PTRACE_DETACH, child, NULL, NULL);
-                while (waitpid(child, status, 0) < 0 && !(WIFEXITED(*status) || WIFSIGNALED(*status))) {}
-                return false;
+                return true;
             }
         }
     }
@@ -58,14 +49,181 @@ applyPatches(pid_t child, const gear *patch_goals, int *status)
 
 #endif  // SCR_MONKEYPATCH
 
+struct workerCommand {
+    size_t test_idx;
+    size_t batch_length; // If 0, then the test runs on its own.
+};
+
+static double
+timevalSeconds(const struct timeval *tv)
+{
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static double
+secondsSince(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void
+convertRusage(const struct rusage *rusage, scrUsage *usage)
+{
+    usage->user_time = timevalSeconds(&rusage->ru_utime);
+    usage->system_time = timevalSeconds(&rusage->ru_stime);
+#ifdef __APPLE__
+    // macOS reports the maximum RSS in bytes rather than kilobytes.
+    usage->max_rss = rusage->ru_maxrss / 1024;
+#else
+    usage->max_rss = rusage->ru_maxrss;
+#endif
+    usage->voluntary_switches = rusage->ru_nvcsw;
+    usage->involuntary_switches = rusage->ru_nivcsw;
+}
+
+static void
+subtractUsage(scrUsage *usage, const scrUsage *base)
+{
+    // The maximum RSS is a high-water mark for the whole process so it's left as is.
+    usage->user_time -= base->user_time;
+    usage->system_time -= base->system_time;
+    usage->voluntary_switches -= base->voluntary_switches;
+    usage->involuntary_switches -= base->involuntary_switches;
+}
+
+static void
+selfUsage(scrUsage *usage)
+{
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    convertRusage(&rusage, usage);
+}
+
+static scrTestCode
+applyXfail(const scrTest *test, scrTestCode result)
+{
+    if (test->options.flags & SCR_TF_XFAIL) {
+        if (result == SCR_TEST_CODE_OK) {
+            return SCR_TEST_CODE_FAIL;
+        }
+        if (result == SCR_TEST_CODE_FAIL) {
+            return SCR_TEST_CODE_OK;
+        }
+    }
+    return result;
+}
+
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(SIGRTMIN)
+
+// Unlike alarm and SIGALRM, tests have no reason to touch the worker's own timer or a real-time signal.
+#define TIMEOUT_SIGNAL SIGRTMIN
+
+static timer_t timeout_timer;
+
+static bool
+timeoutInit(void)
+{
+    struct sigaction action = {.sa_handler = SIG_DFL};
+    struct sigevent event = {.sigev_notify = SIGEV_SIGNAL, .sigev_signo = TIMEOUT_SIGNAL};
+
+    sigaction(TIMEOUT_SIGNAL, &action, NULL);
+    if (timer_create(CLOCK_MONOTONIC, &event, &timeout_timer) != 0) {
+        perror("timer_create");
+        return false;
+    }
+    return true;
+}
+
+static void
+timeoutSet(unsigned int timeout)
+{
+    struct itimerspec value = {.it_value.tv_sec = timeout};
+
+    timer_settime(timeout_timer, 0, &value, NULL);
+}
+
+#else  // _POSIX_TIMERS
+
+#define TIMEOUT_SIGNAL SIGALRM
+
+static bool
+timeoutInit(void)
+{
+    return true;
+}
+
+static void
+timeoutSet(unsigned int timeout)
+{
+    alarm(timeout);
+}
+
+#endif  // _POSIX_TIMERS
+
+static int
+batchDo(scrTestRun *run, size_t first_idx, size_t length)
+{
+    scrBatch *batch = run->batch;
+    jmp_buf exit_point;
+
+    if (!timeoutInit()) {
+        return SCR_TEST_CODE_ERROR;
+    }
+    setExitPoint(&exit_point);
+
+    for (size_t k = 0; k < length; k++) {
+        const scrTest *test = GEAR_GET_ITEM(&run->group->tests, first_idx + k);
+        scrBatchEntry *entry = &batch->entries[k];
+        int result;
+
+        run->test = test;
+        selfUsage(&batch->base_usage);
+        clock_gettime(CLOCK_MONOTONIC, &batch->start);
+        batch->num_started++;
+
+        // A timeout is delivered as a signal since the runner can't tell when each test starts.
+        timeoutSet(test->options.timeout);
+        result = setjmp(exit_point);
+        if (result == 0) {
+            test->test_fn();
+        }
+        timeoutSet(0);
+        fflush(stdout);
+
+        entry->result = result;
+        entry->usage.wall_time = secondsSince(&batch->start);
+        selfUsage(&entry->usage);
+        subtractUsage(&entry->usage, &batch->base_usage);
+        entry->output_ends[0] = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+        entry->output_ends[1] = lseek(STDERR_FILENO, 0, SEEK_CUR);
+        entry->output_ends[2] = lseek(run->log_fd, 0, SEEK_CUR);
+        batch->num_finished++;
+
+        result = applyXfail(test, result);
+        if (run->fail_fast && result != SCR_TEST_CODE_OK && result != SCR_TEST_CODE_SKIP) {
+            break;
+        }
+    }
+
+    setExitPoint(NULL);
+    return SCR_TEST_CODE_OK;
+}
+
 static int
-testDo(const struct testParams *params, const scrTest *test)
+workerDo(scrTestRun *run, int command_fd)
 {
     int stdin_fd, local_errno;
+    struct workerCommand command;
     bool check;
     sigset_t set;
+    double start = monotonicNow();
 
-    setLogFd(params->log_fd);
+    eventsDetach();
+    setLogFd(run->log_fd);
 
     stdin_fd = open("/dev/null", O_RDONLY);
     if (stdin_fd < 0) {
@@ -80,20 +238,28 @@ testDo(const struct testParams *params, const scrTest *test)
         goto error;
     }
 
-    check = (dup2(params->stdout_fd, STDOUT_FILENO) >= 0 && dup2(params->stderr_fd, STDERR_FILENO) >= 0);
+    check = (dup2(run->stdout_fd, STDOUT_FILENO) >= 0 && dup2(run->stderr_fd, STDERR_FILENO) >= 0);
     local_errno = errno;
-    close(params->stdout_fd);
-    close(params->stderr_fd);
+    close(run->stdout_fd);
+    close(run->stderr_fd);
     if (!check) {
         fprintf(stderr, "dup2: %s\n", strerror(local_errno));
         return SCR_TEST_CODE_ERROR;
     }
 
+    if (run->streaming) {
+        // glibc won't switch stdout's existing buffer to line mode unless it's handed a new one.
+        static char stdout_buffer[BUFSIZ];
+
+        setvbuf(stdout, stdout_buffer, _IOLBF, sizeof(stdout_buffer));
+    }
+    *run->redirect_time = monotonicNow() - start;
+
     sigemptyset(&set);
     sigprocmask(SIG_SETMASK, &set, NULL);
 
 #ifdef SCR_MONKEYPATCH
-    if (params->have_patches) {
+    if (run->have_patches) {
         if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1) {
             perror("ptrace (TRACEME)");
             return SCR_TEST_CODE_ERROR;
@@ -102,172 +268,458 @@ testDo(const struct testParams *params, const scrTest *test)
     }
 #endif
 
-    test->test_fn();
+    // Everything up to this point is done before the worker is handed a test.
+    while ((check = (read(command_fd, &command, sizeof(command)) != (ssize_t)sizeof(command))) &&
+           errno == EINTR) {}
+    if (check) {
+        // The runner retired this worker without giving it a test.
+        return SCR_TEST_CODE_OK;
+    }
+    close(command_fd);
+
+    if (command.batch_length > 0) {
+        return batchDo(run, command.test_idx, command.batch_length);
+    }
+
+    run->test = GEAR_GET_ITEM(&run->group->tests, command.test_idx);
+    if (run->test->bench_fn) {
+        benchmarkDo(run->test, run->bench_result);
+    }
+    else {
+        run->test->test_fn();
+    }
+    fflush(stdout);
     return SCR_TEST_CODE_OK;
 
 error:
-    close(params->stdout_fd);
-    close(params->stderr_fd);
+    close(run->stdout_fd);
+    close(run->stderr_fd);
     return SCR_TEST_CODE_ERROR;
 }
 
+// Only the part of each capture file between the run's output starts and the given ends (or the end of the
+// file if negative) belongs to the current test.
+static void
+sendTestOutput(const scrTestRun *fds, const off_t *ends)
+{
+    eventTestOutputRange(fds->test, SCR_OUTPUT_LOG, fds->log_fd, fds->output_starts[2], ends[2]);
+    eventTestOutputRange(fds->test, SCR_OUTPUT_STDOUT, fds->stdout_fd, fds->output_starts[0], ends[0]);
+    eventTestOutputRange(fds->test, SCR_OUTPUT_STDERR, fds->stderr_fd, fds->output_starts[1], ends[1]);
+}
+
 static bool
-hasData(int fd)
+midBatch(const scrTestRun *run)
 {
-    return lseek(fd, 0, SEEK_END) > 0;
+    return run->test_idx < run->batch_end && run->num_reported < run->batch->num_started;
 }
 
 static void
-showTestOutput(const struct testParams *fds)
+measureUsage(scrTestRun *run)
 {
-    bool some_output = false;
+    convertRusage(&run->rusage, &run->usage);
+    if (midBatch(run)) {
+        // The worker died partway through a batch so only count what it used since the current test started.
+        run->usage.wall_time = secondsSince(&run->batch->start);
+        subtractUsage(&run->usage, &run->batch->base_usage);
+    }
+    else {
+        run->usage.wall_time = secondsSince(&run->start);
+    }
+}
 
-    if (hasData(fds->log_fd)) {
-        dumpFd(fds->log_fd, false);
-        some_output = true;
+static void
+measureTiming(const scrTestRun *run, scrTiming *timing)
+{
+    if (run->bench_result->valid) {
+        timing->samples = run->bench_result->repetitions;
+        timing->mean = run->bench_result->mean;
+        timing->stddev = run->bench_result->stddev;
+    }
+    else {
+        timing->samples = 1;
+        timing->mean = run->usage.wall_time;
+        timing->stddev = 0;
     }
+}
+
+static void
+finishReport(scrTestRun *run, scrTestCode ret, scrTestReport *report, bool *show_output)
+{
+    const scrTest *test = run->test;
 
-    if (hasData(fds->stdout_fd)) {
-        printf("\n-------- stdout --------\n");
-        dumpFd(fds->stdout_fd, true);
-        printf("\n------------------------\n");
-        some_output = true;
+    report->result = applyXfail(test, ret);
+    if (report->result == SCR_TEST_CODE_OK || report->result == SCR_TEST_CODE_SKIP) {
+        *show_output = false;
     }
+    measureTiming(run, &report->timing);
+    if (report->result == SCR_TEST_CODE_OK && baselineRegressed(test, &report->timing)) {
+        report->result = SCR_TEST_CODE_FAIL;
+        report->reason = SCR_FINISH_REGRESSED;
+    }
+    report->bench_result = *run->bench_result;
+}
 
-    if (hasData(fds->stderr_fd)) {
-        printf("\n-------- stderr --------\n");
-        dumpFd(fds->stderr_fd, true);
-        printf("\n------------------------\n");
-        some_output = true;
+// The records are how the top-level process learns of each result, even if this group runner dies later on.
+static void
+recordTest(const scrTestRun *run, const scrTestReport *report)
+{
+    scrTestRecord *record = run->test->record;
+
+    record->result = report->result;
+    record->usage = run->usage;
+    record->timing = report->timing;
+    record->finished = true;
+}
+
+// The top-level process shows the result and, if output_ends isn't NULL, the test's captured output.
+static void
+reportTest(const scrTestRun *run, scrTestReport *report, const off_t *output_ends)
+{
+    double start = monotonicNow();
+
+    report->usage = run->usage;
+    eventTestFinished(run->test, report);
+    start = overheadAdd(SCR_PHASE_REPORT, start);
+    if (output_ends) {
+        sendTestOutput(run, output_ends);
+        overheadAdd(SCR_PHASE_SEND_OUTPUT, start);
+        eventSpan(SCR_SPAN_OUTPUT, start);
     }
+    recordTest(run, report);
+}
+
+bool
+batchReport(scrTestRun *run, bool verbose, scrTestCode *result)
+{
+    const scrBatchEntry *entry;
+    bool show_output = true;
+    scrTestReport report = {0};
 
-    if (some_output) {
-        printf("\n");
+    if (run->test_idx >= run->batch_end || run->num_reported == run->batch->num_finished) {
+        return false;
     }
+
+    entry = &run->batch->entries[run->num_reported++];
+    run->usage = entry->usage;
+    report.pid = run->child;
+    finishReport(run, entry->result, &report, &show_output);
+    reportTest(run, &report, (show_output || verbose) ? entry->output_ends : NULL);
+    *result = report.result;
+
+    memcpy(run->output_starts, entry->output_ends, sizeof(run->output_starts));
+    run->test_idx++;
+    // If the worker didn't finish the batch, then it's still holding the test which it was in the middle of.
+    run->test = NULL;
+    if (run->num_reported < run->batch->num_started) {
+        run->test = GEAR_GET_ITEM(&run->group->tests, run->test_idx);
+        eventTestStarted(run->test, run->child);
+    }
+    return true;
 }
 
-static scrTestCode
-summarizeTest(const scrTest *test, const struct testParams *fds, pid_t child, const int *status_ptr,
-              bool verbose)
+scrTestCode
+testFinish(scrTestRun *run, int status, bool timed_out, bool verbose)
 {
-    scrTestCode ret;
-    int status;
-    bool timed_out, show_output = true;
+    bool show_output = !run->streaming;
+    const scrTest *test = run->test;
+    const off_t output_ends[] = {-1, -1, -1};
+    scrTestReport report = {0};
+
+    if (midBatch(run) && WIFSIGNALED(status) && WTERMSIG(status) == TIMEOUT_SIGNAL &&
+        test->options.timeout > 0) {
+        timed_out = true;
+    }
 
-    if (status_ptr) {
-        status = *status_ptr;
-        timed_out = false;
+    measureUsage(run);
+    if (run->counting) {
+        countersStop(&run->counters);
+        report.counters = run->counters;
     }
-    else {
-        waitForProcess(child, test->options.timeout, &status, &timed_out);
+
+    if (run->streaming) {
+        streamClose(run, run->loop);
     }
 
+    report.pid = run->child;
     if (timed_out) {
-        printf("Test result (%s): %sFAIL%s: Timed out\n", test->name, show_color ? RED : "",
-               show_color ? RESET_COLOR : "");
-        ret = SCR_TEST_CODE_FAIL;
+        report.result = SCR_TEST_CODE_FAIL;
+        report.reason = SCR_FINISH_TIMED_OUT;
     }
     else if (WIFSIGNALED(status)) {
-        int signum = WTERMSIG(status);
-
-        printf("Test result (%s): %sERROR%s: Terminated by signal (%i): %s\n", test->name,
-               show_color ? RED : "", show_color ? RESET_COLOR : "", signum, strsignal(signum));
-        ret = SCR_TEST_CODE_ERROR;
+        report.result = SCR_TEST_CODE_ERROR;
+        report.reason = SCR_FINISH_SIGNALED;
+        report.signum = WTERMSIG(status);
     }
     else {
-        ret = WEXITSTATUS(status);
-        if (test->options.flags & SCR_TF_XFAIL) {
-            if (ret == SCR_TEST_CODE_OK) {
-                ret = SCR_TEST_CODE_FAIL;
-            }
-            else if (ret == SCR_TEST_CODE_FAIL) {
-                ret = SCR_TEST_CODE_OK;
-            }
-        }
-        if (ret == SCR_TEST_CODE_OK || ret == SCR_TEST_CODE_SKIP) {
-            show_output = false;
-        }
-        showTestResult(test, ret);
+        finishReport(run, WEXITSTATUS(status), &report, &show_output);
     }
 
-    if (show_output || verbose) {
-        showTestOutput(fds);
+    reportTest(run, &report, (!run->streaming && (show_output || verbose)) ? output_ends : NULL);
+
+    run->test_idx++;
+    run->test = NULL;
+
+    return report.result;
+}
+
+static void
+resetFile(int fd)
+{
+    if (lseek(fd, 0, SEEK_END) > 0) {
+        if (ftruncate(fd, 0) != 0) {}
+        lseek(fd, 0, SEEK_SET);
     }
+}
 
-    return ret;
+static void
+resetCapture(const scrTestRun *run)
+{
+    double start = monotonicNow();
+
+    resetFile(run->stdout_fd);
+    resetFile(run->stderr_fd);
+    resetFile(run->log_fd);
+    overheadAdd(SCR_PHASE_CAPTURE, start);
 }
 
-static int
-makeTempFile(char *template)
+bool
+captureInit(scrTestRun *run)
 {
-    int fd;
+    char stdout_template[] = SCR_TEMPLATE(out), stderr_template[] = SCR_TEMPLATE(err),
+         log_template[] = SCR_TEMPLATE(log);
+    double start = monotonicNow();
 
-    fd = mkstemp(template);
-    if (fd < 0) {
-        perror("mkstemp");
+    run->test = NULL;
+    run->stderr_fd = run->log_fd = -1;
+
+    run->stdout_fd = makeTempFile(stdout_template);
+    if (run->stdout_fd < 0) {
+        return false;
     }
-    else {
-        unlink(template);
+    run->stderr_fd = makeTempFile(stderr_template);
+    if (run->stderr_fd < 0) {
+        goto error;
     }
-    return fd;
+    run->log_fd = makeTempFile(log_template);
+    if (run->log_fd < 0) {
+        goto error;
+    }
+
+    overheadAdd(SCR_PHASE_CAPTURE, start);
+    return true;
+
+error:
+    captureFree(run);
+    return false;
 }
 
-#if defined(ANDROID) || defined(__ANDROID__)
-#define TMP_PREFIX "/data/local"
-#else
-#define TMP_PREFIX
-#endif
-#define TEMPLATE(fmt) TMP_PREFIX "/tmp/scrutiny_" #fmt "_XXXXXX"
+void
+captureFree(scrTestRun *run)
+{
+    close(run->stdout_fd);
+    close(run->stderr_fd);
+    close(run->log_fd);
+}
 
-scrTestCode
-testRun(const scrTest *test, bool verbose)
+bool
+testPrefork(scrTestRun *run)
 {
-#ifdef SCR_MONKEYPATCH
-    int status;
-#endif
-    int *status_ptr = NULL;
-    scrTestCode ret = SCR_TEST_CODE_ERROR;
-    pid_t child;
-    struct testParams params = {.log_fd = -1};
-    char stdout_template[] = TEMPLATE(out), stderr_template[] = TEMPLATE(err), log_template[] = TEMPLATE(log);
-#undef TMP_PREFIX
-#undef TEMPLATE
-
-    params.stdout_fd = makeTempFile(stdout_template);
-    if (params.stdout_fd < 0) {
-        return SCR_TEST_CODE_ERROR;
-    }
-    params.stderr_fd = makeTempFile(stderr_template);
-    if (params.stderr_fd < 0) {
-        goto done;
+    int command_fds[2];
+    double start;
+
+    if (run->streaming && !streamOpen(run)) {
+        return false;
     }
-    params.log_fd = makeTempFile(log_template);
-    if (params.log_fd < 0) {
-        goto done;
+
+    if (pipe(command_fds) != 0) {
+        perror("pipe");
+        goto error;
     }
 
-#ifdef SCR_MONKEYPATCH
-    params.have_patches = (test->patch_goals->length > 0);
-#endif
+    run->test = NULL;
+    run->reaped = false;
 
-    child = cleanFork();
-    switch (child) {
-    case -1: perror("fork"); goto done;
-    case 0: _exit(testDo(&params, test)); break;
+    start = monotonicNow();
+    run->child = cleanFork();
+    switch (run->child) {
+    case -1:
+        perror("fork");
+        close(command_fds[0]);
+        close(command_fds[1]);
+        goto error;
+    case 0:
+        close(command_fds[1]);
+        _exit(workerDo(run, command_fds[0]));
+        break;
     default: break;
     }
 
+    overheadAdd(SCR_PHASE_FORK, start);
+    eventSpan(SCR_SPAN_FORK, start);
+    close(command_fds[0]);
+    run->command_fd = command_fds[1];
+    run->idle = true;
+
+    if (run->streaming) {
+        // Otherwise, workers forked later on would hold the pipes open.
+        streamDetach(run);
+    }
+
 #ifdef SCR_MONKEYPATCH
-    if (params.have_patches && !applyPatches(child, test->patch_goals, &status)) {
-        status_ptr = &status;
+    if (run->have_patches &&
+        !applyPatches(run->child, &run->group->patch_goals, &run->status, &run->rusage)) {
+        run->reaped = true;
     }
 #endif
 
-    ret = summarizeTest(test, &params, child, status_ptr, verbose);
+    return true;
+
+error:
+    if (run->streaming) {
+        streamClose(run, NULL);
+    }
+    return false;
+}
+
+// Waits for an idle worker whose command pipe has been closed.
+void
+testRetire(scrTestRun *run)
+{
+    if (!run->reaped) {
+        while (waitpid(run->child, NULL, 0) < 0 && errno == EINTR) {}
+    }
+    if (run->streaming) {
+        streamClose(run, NULL);
+    }
+    workerOverhead(run);
+    run->idle = false;
+}
+
+// Workers time their own setup since the group runner can't see it.
+void
+workerOverhead(scrTestRun *run)
+{
+    if (*run->redirect_time > 0) {
+        overheadAddTime(SCR_PHASE_REDIRECT, *run->redirect_time);
+        *run->redirect_time = 0;
+    }
+}
+
+bool
+testStart(scrTestRun *run, size_t test_idx, size_t batch_length)
+{
+    const scrTest *test = GEAR_GET_ITEM(&run->group->tests, test_idx);
+    struct workerCommand command = {.test_idx = test_idx, .batch_length = batch_length};
+
+    if (!run->idle && !testPrefork(run)) {
+        return false;
+    }
+    run->idle = false;
+
+    if (!run->streaming) {
+        resetCapture(run);
+    }
+    memset(run->output_starts, 0, sizeof(run->output_starts));
+
+    run->test = test;
+    run->test_idx = test_idx;
+    run->batch_end = test_idx + batch_length;
+    if (batch_length > 0) {
+        run->num_reported = run->batch->num_started = run->batch->num_finished = 0;
+    }
+    run->bench_result->valid = false;
+    clock_gettime(CLOCK_MONOTONIC, &run->start);
+    eventTestStarted(test, run->child);
+
+    // If the worker has already died, then the write will fail and the loop will reap it as usual.
+    if (write(run->command_fd, &command, sizeof(command)) < 0) {}
+    close(run->command_fd);
+
+    if (run->reaped) {
+        return true;
+    }
+
+    if (run->counting) {
+        countersStart(&run->counters, run->child);
+    }
+
+    if (run->streaming) {
+        streamWatch(run, run->loop);
+    }
+
+    loopAddChild(run->loop, run->child, (batch_length > 0) ? 0 : test->options.timeout);
+    return true;
+}
+
+static bool
+redirectOutput(int stdout_fd, int stderr_fd)
+{
+    double start = monotonicNow();
+
+    fflush(stdout);
+    fflush(stderr);
+    if (dup2(stdout_fd, STDOUT_FILENO) < 0 || dup2(stderr_fd, STDERR_FILENO) < 0) {
+        perror("dup2");
+        return false;
+    }
+    overheadAdd(SCR_PHASE_REDIRECT, start);
+    return true;
+}
+
+scrTestCode
+testInline(scrTestRun *run, size_t test_idx, bool verbose)
+{
+    int saved_stdout, saved_stderr, saved_log_fd, result;
+    bool show_output = true;
+    const off_t output_ends[] = {-1, -1, -1};
+    scrUsage base_usage;
+    scrTestReport report = {0};
+    jmp_buf exit_point;
+
+    run->test = GEAR_GET_ITEM(&run->group->tests, test_idx);
+    run->test_idx = run->batch_end = test_idx;
+    run->bench_result->valid = false;
+    memset(&run->usage, 0, sizeof(run->usage));
+    resetCapture(run);
+    memset(run->output_starts, 0, sizeof(run->output_starts));
+
+    saved_stdout = dup(STDOUT_FILENO);
+    saved_stderr = dup(STDERR_FILENO);
+    if (saved_stdout < 0 || saved_stderr < 0 || !redirectOutput(run->stdout_fd, run->stderr_fd)) {
+        close(saved_stdout);
+        close(saved_stderr);
+        report.result = SCR_TEST_CODE_ERROR;
+        recordTest(run, &report);
+        run->test = NULL;
+        return SCR_TEST_CODE_ERROR;
+    }
+    saved_log_fd = setLogFd(run->log_fd);
+
+    selfUsage(&base_usage);
+    clock_gettime(CLOCK_MONOTONIC, &run->start);
+    eventTestStarted(run->test, getpid());
+
+    setExitPoint(&exit_point);
+    result = setjmp(exit_point);
+    if (result == 0) {
+        run->test->test_fn();
+    }
+    setExitPoint(NULL);
+
+    run->usage.wall_time = secondsSince(&run->start);
+    selfUsage(&run->usage);
+    subtractUsage(&run->usage, &base_usage);
+
+    redirectOutput(saved_stdout, saved_stderr);
+    close(saved_stdout);
+    close(saved_stderr);
+    setLogFd(saved_log_fd);
+
+    report.pid = getpid();
+    finishReport(run, result, &report, &show_output);
+    reportTest(run, &report, (show_output || verbose) ? output_ends : NULL);
 
-done:
-    close(params.stdout_fd);
-    close(params.stderr_fd);
-    close(params.log_fd);
-    return ret;
+    run->test_idx++;
+    run->test = NULL;
+    return report.result;
 }
@@ -0,0 +1,328 @@
+#include <fnmatch.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+
+#define SHARD_INDEX_VARIABLE "SCRUTINY_SHARD_INDEX"
+#define SHARD_COUNT_VARIABLE "SCRUTINY_SHARD_COUNT"
+
+typedef enum patternKind {
+    PATTERN_SUBSTRING,
+    PATTERN_GLOB,     // Only '*' and '?'.
+    PATTERN_FNMATCH,  // Bracket expressions or escapes.
+} patternKind;
+
+typedef struct filterPattern {
+    patternKind kind;
+    const char *text;
+    size_t prefix_length; // How many characters a name must start with verbatim.
+} filterPattern;
+
+typedef struct filterSet {
+    filterPattern *patterns;
+    size_t length;
+} filterSet;
+
+typedef struct shardItem {
+    scrTest *test;
+    size_t group_idx;
+    size_t test_idx;
+} shardItem;
+
+// Patterns are classified once so that matching each name doesn't have to look for wildcards again.
+static bool
+compileFilters(const char *const *texts, filterSet *set)
+{
+    size_t length = 0;
+
+    set->patterns = NULL;
+    set->length = 0;
+    if (!texts) {
+        return true;
+    }
+
+    while (texts[length]) {
+        length++;
+    }
+    if (length == 0) {
+        return true;
+    }
+
+    set->patterns = malloc(sizeof(*set->patterns) * length);
+    if (!set->patterns) {
+        return false;
+    }
+    set->length = length;
+
+    for (size_t k = 0; k < length; k++) {
+        filterPattern *pattern = &set->patterns[k];
+        const char *wildcards;
+
+        pattern->text = texts[k];
+        pattern->prefix_length = strcspn(texts[k], "*?[\\");
+        wildcards = texts[k] + pattern->prefix_length;
+        if (*wildcards == '\0') {
+            pattern->kind = PATTERN_SUBSTRING;
+        }
+        else if (wildcards[strcspn(wildcards, "[\\")] == '\0') {
+            pattern->kind = PATTERN_GLOB;
+        }
+        else {
+            pattern->kind = PATTERN_FNMATCH;
+        }
+    }
+
+    return true;
+}
+
+// Matches '*' and '?' by backtracking to the most recent star, which never needs more than one pass per star.
+static bool
+globMatch(const char *pattern, const char *name)
+{
+    const char *star = NULL, *resume = NULL;
+
+    while (*name) {
+        if (*pattern == '*') {
+            star = ++pattern;
+            resume = name;
+        }
+        else if (*pattern == '?' || *pattern == *name) {
+            pattern++;
+            name++;
+        }
+        else if (star) {
+            pattern = star;
+            name = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == '\0';
+}
+
+static bool
+patternMatch(const filterPattern *pattern, const char *name)
+{
+    switch (pattern->kind) {
+    case PATTERN_SUBSTRING: return strstr(name, pattern->text) != NULL;
+    case PATTERN_GLOB:
+        return strncmp(name, pattern->text, pattern->prefix_length) == 0 &&
+               globMatch(pattern->text + pattern->prefix_length, name + pattern->prefix_length);
+    default:
+        return strncmp(name, pattern->text, pattern->prefix_length) == 0 &&
+               fnmatch(pattern->text, name, 0) == 0;
+    }
+}
+
+static bool
+setMatch(const filterSet *set, const char *name)
+{
+    for (size_t k = 0; k < set->length; k++) {
+        if (patternMatch(&set->patterns[k], name)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+readVariable(const char *name, unsigned int *value)
+{
+    const char *string;
+    char *end;
+    unsigned long number;
+
+    string = getenv(name);
+    if (!string || !*string) {
+        return true;
+    }
+
+    number = strtoul(string, &end, 10);
+    if (*end || number > UINT32_MAX) {
+        fprintf(stderr, "Invalid value for %s: %s\n", name, string);
+        return false;
+    }
+
+    *value = number;
+    return true;
+}
+
+// Longest first and then by position so that every shard comes up with the same assignment.
+static int
+compareItems(const void *item1, const void *item2)
+{
+    const shardItem *a = item1, *b = item2;
+    double a_time = a->test->expected_time, b_time = b->test->expected_time;
+
+    if (a_time != b_time) {
+        return (a_time < b_time) - (a_time > b_time);
+    }
+    if (a->group_idx != b->group_idx) {
+        return (a->group_idx > b->group_idx) - (a->group_idx < b->group_idx);
+    }
+    return (a->test_idx > b->test_idx) - (a->test_idx < b->test_idx);
+}
+
+static bool
+balanceShards(unsigned int shard_index, unsigned int shard_count, size_t num_tests)
+{
+    shardItem *items;
+    double *loads;
+    size_t num_items = 0;
+    scrGroupStruct *group;
+    size_t group_idx;
+
+    loads = calloc(shard_count, sizeof(*loads));
+    items = malloc(sizeof(*items) * num_tests);
+    if (!loads || !items) {
+        free(loads);
+        free(items);
+        return false;
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+        size_t test_idx;
+
+        GEAR_FOR_EACH_WITH_INDEX(&group->tests, test, test_idx)
+        {
+            if (test->selected && test->expected_time >= 0) {
+                items[num_items++] = (shardItem){.test = test, .group_idx = group_idx, .test_idx = test_idx};
+            }
+        }
+    }
+    qsort(items, num_items, sizeof(*items), compareItems);
+
+    // Each test goes to whichever shard currently has the least work.
+    for (size_t k = 0; k < num_items; k++) {
+        unsigned int lightest = 0;
+
+        for (unsigned int shard = 1; shard < shard_count; shard++) {
+            if (loads[shard] < loads[lightest]) {
+                lightest = shard;
+            }
+        }
+        loads[lightest] += items[k].test->expected_time;
+        items[k].test->selected = (lightest == shard_index);
+    }
+
+    free(loads);
+    free(items);
+    return true;
+}
+
+// Marks the tests which pass the filters.  Exclusions win over inclusions.
+static size_t
+filterTests(const scrOptions *options)
+{
+    filterSet include, exclude;
+    scrGroupStruct *group;
+    size_t num_tests = 0;
+
+    if (!compileFilters(options->include_filters, &include) ||
+        !compileFilters(options->exclude_filters, &exclude)) {
+        exit(1);
+    }
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        scrTest *test;
+
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            test->selected = (include.length == 0 || setMatch(&include, test->name)) &&
+                             !setMatch(&exclude, test->name);
+            num_tests += test->selected;
+        }
+    }
+
+    free(include.patterns);
+    free(exclude.patterns);
+    return num_tests;
+}
+
+bool
+selectTests(const scrOptions *options)
+{
+    unsigned int shard_index = options->shard_index, shard_count = options->shard_count;
+    bool balanced = false;
+    scrGroupStruct *group;
+    size_t group_idx, num_tests = 0, num_filtered, num_selected = 0;
+
+    if (shard_count == 0 && (!readVariable(SHARD_INDEX_VARIABLE, &shard_index) ||
+                             !readVariable(SHARD_COUNT_VARIABLE, &shard_count))) {
+        return false;
+    }
+    if (shard_count > 1 && shard_index >= shard_count) {
+        fprintf(stderr, "The shard index (%u) must be less than the shard count (%u)\n", shard_index,
+                shard_count);
+        return false;
+    }
+
+    GEAR_FOR_EACH(&groups, group)
+    {
+        num_tests += group->tests.length;
+    }
+
+    // The shards split whatever the filters leave so that they stay balanced.
+    num_filtered = filterTests(options);
+    if (shard_count > 1 && historyLoaded() && num_filtered > 0) {
+        balanced = balanceShards(shard_index, shard_count, num_filtered);
+    }
+
+    GEAR_FOR_EACH_WITH_INDEX(&groups, group, group_idx)
+    {
+        scrTest *test;
+
+        group->num_selected = 0;
+        GEAR_FOR_EACH(&group->tests, test)
+        {
+            if (test->selected && shard_count > 1 && (!balanced || test->expected_time < 0)) {
+                test->selected = (hashTest(group_idx, test->name) % shard_count == shard_index);
+            }
+            group->num_selected += test->selected;
+        }
+        num_selected += group->num_selected;
+    }
+
+    if (shard_count > 1) {
+        printf("Shard %u of %u: %zu of %zu tests\n\n", shard_index + 1, shard_count, num_selected, num_tests);
+    }
+    else if (num_selected < num_tests) {
+        printf("Selected %zu of %zu tests\n\n", num_selected, num_tests);
+    }
+
+    return true;
+}
+
+void
+pruneTests(scrGroupStruct *group)
+{
+    gear selected;
+    scrTest *test;
+
+    if (group->num_selected == group->tests.length) {
+        return;
+    }
+
+    // The group runner has its own copy of the tests so the unselected ones can simply be dropped.
+    gearInit(&selected, sizeof(scrTest));
+    GEAR_FOR_EACH(&group->tests, test)
+    {
+        if (test->selected && gearAppend(&selected, test) != GEAR_RET_OK) {
+            exit(1);
+        }
+    }
+
+    gearReset(&group->tests);
+    group->tests = selected;
+}
@@ -0,0 +1,181 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+
+// The table is kept at most half full so that probes stay short.
+#define MIN_SLOTS 64
+
+// Returns the slot which holds the key or else the empty one where it would go.
+static size_t
+findSlot(const scrStore *store, size_t group_idx, const char *name)
+{
+    size_t mask = store->num_slots - 1;
+    size_t slot = hashTest(group_idx, name) & mask;
+
+    while (store->slots[slot] != 0) {
+        const scrStoreKey *key = GEAR_GET_ITEM(&store->entries, store->slots[slot] - 1);
+
+        if (key->group_idx == group_idx &&
+            (name ? key->name && strcmp(key->name, name) == 0 : !key->name)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static bool
+growSlots(scrStore *store)
+{
+    size_t num_slots = store->num_slots ? 2 * store->num_slots : MIN_SLOTS;
+    size_t *slots;
+
+    slots = calloc(num_slots, sizeof(*slots));
+    if (!slots) {
+        return false;
+    }
+    free(store->slots);
+    store->slots = slots;
+    store->num_slots = num_slots;
+
+    for (size_t idx = 0; idx < store->entries.length; idx++) {
+        const scrStoreKey *key = GEAR_GET_ITEM(&store->entries, idx);
+
+        store->slots[findSlot(store, key->group_idx, key->name)] = idx + 1;
+    }
+
+    return true;
+}
+
+void
+storeInit(scrStore *store, size_t entry_size)
+{
+    gearInit(&store->entries, entry_size);
+    store->slots = NULL;
+    store->num_slots = 0;
+}
+
+void *
+storeFind(const scrStore *store, size_t group_idx, const char *name)
+{
+    size_t slot;
+
+    if (store->num_slots == 0) {
+        return NULL;
+    }
+
+    slot = findSlot(store, group_idx, name);
+    return store->slots[slot] ? GEAR_GET_ITEM(&store->entries, store->slots[slot] - 1) : NULL;
+}
+
+// The entry's name is copied.  Returns the stored entry or NULL if memory ran out.
+void *
+storeAdd(scrStore *store, const void *entry)
+{
+    const scrStoreKey *key = entry;
+    scrStoreKey *added;
+    char *name = NULL;
+
+    if ((store->entries.length + 1) * 2 > store->num_slots && !growSlots(store)) {
+        return NULL;
+    }
+
+    if (key->name) {
+        name = strdup(key->name);
+        if (!name) {
+            return NULL;
+        }
+    }
+    if (gearAppend(&store->entries, entry) != GEAR_RET_OK) {
+        free(name);
+        return NULL;
+    }
+
+    added = GEAR_GET_ITEM(&store->entries, store->entries.length - 1);
+    added->name = name;
+    store->slots[findSlot(store, added->group_idx, added->name)] = store->entries.length;
+    return added;
+}
+
+bool
+storeRead(scrStore *store, FILE *file, const char *header, scrStoreParseFn *parse_fn, void *arg)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    bool ret = false;
+
+    length = getline(&line, &size, file);
+    if (length < 0 || strcmp(line, header) != 0) {
+        goto done;
+    }
+
+    while ((length = getline(&line, &size, file)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+
+        if (!parse_fn(store, line, arg)) {
+            goto done;
+        }
+    }
+
+    ret = true;
+
+done:
+    free(line);
+    return ret;
+}
+
+void
+storeWrite(const char *path, const char *what, scrStoreWriteFn *write_fn)
+{
+    FILE *file;
+    char *tmp_path;
+
+    // Write to a temporary file first so that an interrupted run can't leave a truncated file behind.
+    tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp_path) {
+        return;
+    }
+    sprintf(tmp_path, "%s.tmp", path);
+
+    file = fopen(tmp_path, "w");
+    if (!file) {
+        perror("fopen");
+        free(tmp_path);
+        return;
+    }
+
+    write_fn(file);
+
+    if (fclose(file) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write the %s: %s\n", what, strerror(errno));
+        remove(tmp_path);
+    }
+    free(tmp_path);
+}
+
+void
+storeFree(scrStore *store)
+{
+    scrStoreKey *key;
+
+    if (store->entries.item_size == 0) {
+        return;
+    }
+
+    GEAR_FOR_EACH(&store->entries, key)
+    {
+        free(key->name);
+    }
+    gearReset(&store->entries);
+
+    free(store->slots);
+    store->slots = NULL;
+    store->num_slots = 0;
+}
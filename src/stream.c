@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+static void
+emitLine(const scrOutputStream *stream, const char *line, size_t length)
+{
+    eventTestOutput(stream->run->test, stream->kind, true, line, length);
+}
+
+static void
+flushPartial(scrOutputStream *stream)
+{
+    if (stream->partial_length > 0) {
+        emitLine(stream, stream->partial, stream->partial_length);
+        stream->partial_length = 0;
+    }
+}
+
+static bool
+drainStream(void *arg)
+{
+    scrOutputStream *stream = arg;
+    ssize_t transmitted;
+    char buffer[1024];
+
+    while ((transmitted = read(stream->fd, buffer, sizeof(buffer))) > 0) {
+        if (stream->kind != SCR_OUTPUT_LOG) {
+            replaceNonPrintable(buffer, transmitted);
+        }
+
+        for (ssize_t k = 0; k < transmitted; k++) {
+            if (buffer[k] == '\n') {
+                emitLine(stream, stream->partial, stream->partial_length);
+                stream->partial_length = 0;
+                continue;
+            }
+
+            if (stream->partial_length == sizeof(stream->partial)) {
+                flushPartial(stream);
+            }
+            stream->partial[stream->partial_length++] = buffer[k];
+        }
+    }
+
+    return transmitted != 0;
+}
+
+bool
+streamOpen(scrTestRun *run)
+{
+    int *write_fds[] = {&run->stdout_fd, &run->stderr_fd, &run->log_fd};
+
+    for (unsigned int k = 0; k < ARRAY_LENGTH(run->streams); k++) {
+        run->streams[k].fd = *write_fds[k] = -1;
+    }
+
+    for (unsigned int k = 0; k < ARRAY_LENGTH(run->streams); k++) {
+        int fds[2];
+        scrOutputStream *stream = &run->streams[k];
+
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            streamClose(run, NULL);
+            return false;
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+        stream->run = run;
+        stream->fd = fds[0];
+        stream->kind = k;
+        stream->partial_length = 0;
+        *write_fds[k] = fds[1];
+    }
+
+    return true;
+}
+
+void
+streamDetach(scrTestRun *run)
+{
+    close(run->stdout_fd);
+    close(run->stderr_fd);
+    close(run->log_fd);
+    run->stdout_fd = run->stderr_fd = run->log_fd = -1;
+}
+
+void
+streamWatch(scrTestRun *run, scrEventLoop *loop)
+{
+    for (unsigned int k = 0; k < ARRAY_LENGTH(run->streams); k++) {
+        loopWatchStream(loop, run->streams[k].fd, drainStream, &run->streams[k]);
+    }
+}
+
+void
+streamClose(scrTestRun *run, scrEventLoop *loop)
+{
+    streamDetach(run);
+
+    for (unsigned int k = 0; k < ARRAY_LENGTH(run->streams); k++) {
+        scrOutputStream *stream = &run->streams[k];
+
+        if (stream->fd < 0) {
+            continue;
+        }
+
+        if (loop) {
+            loopUnwatchStream(loop, stream->fd);
+        }
+        if (run->test) {
+            drainStream(stream);
+            flushPartial(stream);
+        }
+        close(stream->fd);
+        stream->fd = -1;
+    }
+}
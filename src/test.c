@@ -11,6 +11,7 @@
 
 static void *group_ctx;
 static int log_fd;
+static jmp_buf *exit_point;
 
 #define LOG_STRING(str)                                 \
     do {                                                \
@@ -68,10 +69,29 @@ setGroupCtx(void *ctx)
     group_ctx = ctx;
 }
 
-void
+int
 setLogFd(int fd)
 {
+    int old_fd = log_fd;
+
     log_fd = fd;
+    return old_fd;
+}
+
+void
+setExitPoint(jmp_buf *point)
+{
+    exit_point = point;
+}
+
+static SCR_NORETURN void
+exitTest(scrTestCode result)
+{
+    // Batched tests jump back to the worker so that it can go on to the next test.
+    if (exit_point) {
+        longjmp(*exit_point, result);
+    }
+    _exit(result);
 }
 
 void *
@@ -83,7 +103,7 @@ scrGroupCtx(void)
 void
 scrTestSkip(void)
 {
-    _exit(SCR_TEST_CODE_SKIP);
+    exitTest(SCR_TEST_CODE_SKIP);
 }
 
 void
@@ -123,7 +143,7 @@ scrFail(SCR_CONTEXT_DECL, const char *format, ...)
         LOG_STRING(RESET_COLOR);
     }
 
-    _exit(SCR_TEST_CODE_FAIL);
+    exitTest(SCR_TEST_CODE_FAIL);
 }
 
 SCR_ASSERT_FUNC(Eq, intmax_t)
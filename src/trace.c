@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+static FILE *trace;
+static double origin;
+static const char *separator;
+
+// The trace is a JSON array of events.  Viewers accept it without the closing bracket so it's still usable if
+// the run is cut short.
+static void
+startEvent(void)
+{
+    fputs(separator, trace);
+    separator = ",\n";
+}
+
+bool
+traceOpen(const scrOptions *options)
+{
+    trace = NULL;
+    if (!options->trace_file) {
+        return true;
+    }
+
+    trace = fopen(options->trace_file, "w");
+    if (!trace) {
+        perror(options->trace_file);
+        return false;
+    }
+
+    origin = monotonicNow();
+    separator = "[\n";
+    traceNameProcess(getpid(), "scrutiny");
+    return true;
+}
+
+bool
+traceActive(void)
+{
+    return trace;
+}
+
+void
+traceNameProcess(pid_t pid, const char *name)
+{
+    if (!trace) {
+        return;
+    }
+
+    startEvent();
+    fprintf(trace, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%li,\"args\":{\"name\":", (long)pid);
+    writeJson(trace, name, strlen(name));
+    fputs("}}", trace);
+}
+
+// Each group runner is a process in the trace and each of its workers is a thread.
+void
+traceSpan(pid_t pid, pid_t tid, const char *name, const char *category, double start, double end)
+{
+    if (!trace) {
+        return;
+    }
+
+    startEvent();
+    fputs("{\"ph\":\"X\",\"name\":", trace);
+    writeJson(trace, name, strlen(name));
+    fprintf(trace, ",\"cat\":\"%s\",\"pid\":%li,\"tid\":%li,\"ts\":%.3f,\"dur\":%.3f}", category, (long)pid,
+            (long)tid, (start - origin) * 1e6, (end > start) ? (end - start) * 1e6 : 0);
+}
+
+void
+traceClose(void)
+{
+    if (!trace) {
+        return;
+    }
+
+    fputs("\n]\n", trace);
+    if (fclose(trace) != 0) {
+        perror("Failed to write the trace");
+    }
+    trace = NULL;
+}
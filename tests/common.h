@@ -1,6 +1,16 @@
 #ifndef SCRUTINY_TESTS_COMMON_H
 #define SCRUTINY_TESTS_COMMON_H
 
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
 #define ADD_PASS(test)                             \
     do {                                           \
         scrGroupAddTest(group, #test, test, NULL); \
@@ -37,4 +47,87 @@
         num_skip++;                                \
     } while (0)
 
+// Creates an empty file from a mkstemp template.
+static inline bool
+createTempFile(char *template)
+{
+    int fd;
+
+    fd = mkstemp(template);
+    if (fd < 0) {
+        perror("mkstemp");
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+// The contents are always null-terminated, even if they had to be cut short.
+static inline bool
+readFile(const char *path, char *buffer, size_t size)
+{
+    ssize_t length;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    length = read(fd, buffer, size - 1);
+    close(fd);
+    if (length < 0) {
+        return false;
+    }
+
+    buffer[length] = '\0';
+    return true;
+}
+
+static inline bool
+writeFile(const char *path, const char *contents)
+{
+    ssize_t length;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_TRUNC);
+    if (fd < 0) {
+        return false;
+    }
+    length = write(fd, contents, strlen(contents));
+    close(fd);
+    return length == (ssize_t)strlen(contents);
+}
+
+// Tests append to a log so that which of them ran, and in what order, can be checked afterwards.
+static inline void
+logAppend(const char *path, const char *text)
+{
+    ssize_t length;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        SCR_FAIL("Failed to open the log");
+    }
+    length = write(fd, text, strlen(text));
+    close(fd);
+    SCR_ASSERT_EQ(length, strlen(text));
+}
+
+// Checks what was logged since the last check and then empties the log.
+static inline bool
+logEquals(const char *path, const char *expected)
+{
+    char buffer[256];
+
+    return readFile(path, buffer, sizeof(buffer)) && truncate(path, 0) == 0 && strcmp(buffer, expected) == 0;
+}
+
+static inline bool
+counted(const scrStats *stats, unsigned int num_pass, unsigned int num_fail)
+{
+    return stats->num_passed == num_pass && stats->num_failed == num_fail && stats->num_skipped == 0 &&
+           stats->num_errored == 0;
+}
+
 #endif  // SCRUTINY_TESTS_COMMON_H
@@ -10,6 +10,9 @@ $(AUX_LIB): $(TEST_DIR)/aux.c
 $(TEST_DIR)/test_monkeypatch: $(TEST_DIR)/test_monkeypatch.c $(TEST_DIR)/common.h $(SCR_SHARED_LIBRARY) $(AUX_LIB)
 	$(CC) $(CFLAGS) $(SCR_INCLUDE_FLAGS) $< -Wl,-rpath $(CURDIR) -Wl,-rpath $(TEST_DIR) -L$(CURDIR) -L$(TEST_DIR) -lscrutiny -laux -o $@
 
+# With full RELRO, the GOT entries that SCR_RF_PATCH_ONCE writes are read-only by the time that main runs.
+$(TEST_DIR)/test_patch_once: private CFLAGS += -Wl,-z,relro,-z,now
+
 endif
 
 tests: $(TEST_BINARIES)
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static volatile unsigned long counter;
+
+static void
+sleep_briefly(void)
+{
+    usleep(20000);
+}
+
+static void
+increment(unsigned long iterations)
+{
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    scrGroup group;
+    char baseline_file[] = "/tmp/scrutiny_baseline_XXXXXX";
+    const scrBenchmarkOptions bench_options = {.repetitions = 3, .target_time = 0.01};
+    scrOptions options = {.baseline_file = baseline_file, .regression_threshold = 1.0};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(baseline_file)) {
+        return 1;
+    }
+    unlink(baseline_file);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupAddTest(group, "sleep_briefly", sleep_briefly, NULL);
+    scrGroupAddBenchmark(group, "increment", increment, &bench_options);
+
+    // Record a baseline and then compare against it.
+    options.flags = SCR_RF_UPDATE_BASELINE;
+    scrRun(&options, &stats);
+    ok = counted(&stats, 2, 0);
+
+    options.flags = 0;
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 2, 0);
+
+    // Both tests are far slower than this baseline claims.
+    ok = ok && writeFile(baseline_file, "# scrutiny baseline 1\n"
+                                        "0 10 0.001 0.0001 sleep_briefly\n"
+                                        "0 10 1e-12 1e-13 increment\n");
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 0, 2);
+
+    // A single sample says nothing about how much the tests vary so they aren't judged by it.
+    ok = ok && writeFile(baseline_file, "# scrutiny baseline 1\n"
+                                        "0 1 0.001 0 sleep_briefly\n"
+                                        "0 1 1e-12 0 increment\n");
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 2, 0);
+
+    unlink(baseline_file);
+    return !ok;
+}
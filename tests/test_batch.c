@@ -0,0 +1,156 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static pid_t remembered_pid;
+
+static void
+remember_pid(void)
+{
+    remembered_pid = getpid();
+}
+
+static void
+same_process(void)
+{
+    SCR_ASSERT_EQ(remembered_pid, getpid());
+}
+
+static void
+new_process(void)
+{
+    SCR_ASSERT_EQ(remembered_pid, 0);
+}
+
+static void
+pass_me(void)
+{
+    printf("This shouldn't be shown\n");
+}
+
+static void
+fail_me(void)
+{
+    printf("This should be shown\n");
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+xfail_me(void)
+{
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+xpass_me(void)
+{
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+static void
+error_me(void)
+{
+    raise(SIGSEGV);
+}
+
+static void
+exit_early(void)
+{
+    exit(0);
+}
+
+static void
+fail_timeout(void)
+{
+    sleep(5);
+}
+
+static void
+ignore_alarm(void)
+{
+    signal(SIGALRM, SIG_IGN);
+    alarm(1);
+}
+
+static void
+cancel_alarm(void)
+{
+    alarm(0);
+    sleep(5);
+}
+
+static void
+increment(unsigned long iterations)
+{
+    static volatile unsigned long counter;
+
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    scrOptions options = {.isolation = SCR_ISOLATION_BATCH};
+    const scrTestOptions xfail_options = {.flags = SCR_TF_XFAIL}, timeout_options = {.timeout = 1};
+    const scrBenchmarkOptions bench_options = {.repetitions = 3, .target_time = 0.001};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(remember_pid);
+    ADD_FAIL(fail_me);
+    ADD_SKIP(skip_me);
+    ADD_XFAIL(xfail_me);
+    ADD_XPASS(xpass_me);
+    ADD_PASS(same_process);
+    ADD_ERROR(error_me);
+    ADD_PASS(new_process);
+    ADD_PASS(remember_pid);
+    ADD_PASS(exit_early);
+    ADD_PASS(new_process);
+    ADD_PASS(remember_pid);
+    ADD_TIMEOUT(fail_timeout);
+    ADD_PASS(new_process);
+    scrGroupAddBenchmark(group, "increment", increment, &bench_options);
+    num_pass++;
+    ADD_PASS(new_process);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetJobs(group, 2);
+    for (int k = 0; k < 150; k++) {
+        ADD_PASS(pass_me);
+        ADD_FAIL(fail_me);
+    }
+
+    // Tests which use alarm themselves can't get in the way of their own timeouts or the later tests'.
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(ignore_alarm);
+    ADD_TIMEOUT(fail_timeout);
+    ADD_TIMEOUT(cancel_alarm);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetIsolation(group, SCR_ISOLATION_TEST);
+    ADD_PASS(remember_pid);
+    ADD_PASS(new_process);
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static volatile unsigned long counter;
+
+static void
+increment(unsigned long iterations)
+{
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+static void
+fail_benchmark(unsigned long iterations)
+{
+    (void)iterations;
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+pass_me(void)
+{
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    const scrBenchmarkOptions quick_options = {.repetitions = 5, .target_time = 0.01},
+                              timeout_options = {.timeout = 1, .target_time = 10};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupAddBenchmark(group, "increment", increment, &quick_options);
+    num_pass++;
+    scrGroupAddBenchmark(group, "increment_defaults", increment, NULL);
+    num_pass++;
+    scrGroupAddBenchmark(group, "fail_benchmark", fail_benchmark, NULL);
+    num_fail++;
+    scrGroupAddBenchmark(group, "timeout_benchmark", increment, &timeout_options);
+    num_fail++;
+    ADD_PASS(pass_me);
+
+    scrRun(NULL, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
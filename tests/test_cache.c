@@ -0,0 +1,80 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static char log_path[] = "/tmp/scrutiny_cache_log_XXXXXX";
+
+static void
+pass_a(void)
+{
+    logAppend(log_path, "a");
+}
+
+static void
+pass_b(void)
+{
+    logAppend(log_path, "b");
+}
+
+static void
+fail_c(void)
+{
+    logAppend(log_path, "c");
+    SCR_FAIL("Failing on purpose");
+}
+
+static bool
+countedCached(const scrStats *stats, unsigned int num_pass, unsigned int num_fail, unsigned int num_cached)
+{
+    return counted(stats, num_pass, num_fail) && stats->num_cached == num_cached;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_fail = 0;
+    char cache_path[] = "/tmp/scrutiny_cache_XXXXXX";
+    scrGroup group;
+    scrOptions options = {.max_jobs = 1, .cache_file = cache_path};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(cache_path) || !createTempFile(log_path)) {
+        return 1;
+    }
+    unlink(cache_path);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(pass_a);
+    ADD_FAIL(fail_c);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(pass_b);
+
+    scrRun(&options, &stats);
+    ok = countedCached(&stats, num_pass, num_fail, 0) && logEquals(log_path, "acb");
+
+    // Only the failing test has to run again.
+    scrRun(&options, &stats);
+    ok = ok && countedCached(&stats, num_pass, num_fail, 2) && logEquals(log_path, "c");
+
+    options.flags = SCR_RF_REFRESH_CACHE;
+    scrRun(&options, &stats);
+    ok = ok && countedCached(&stats, num_pass, num_fail, 0) && logEquals(log_path, "acb");
+
+    // A different binary invalidates everything.
+    ok = ok && writeFile(cache_path, "# scrutiny cache 1\nbinary 0000000000000000\n0 pass_a\n1 pass_b\n");
+    options.flags = 0;
+    scrRun(&options, &stats);
+    ok = ok && countedCached(&stats, num_pass, num_fail, 0) && logEquals(log_path, "acb");
+
+    unlink(cache_path);
+    unlink(log_path);
+    return !ok;
+}
@@ -0,0 +1,54 @@
+#include <stdio.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static volatile unsigned long counter;
+
+static void
+loop_briefly(void)
+{
+    for (unsigned long k = 0; k < 1000000; k++) {
+        counter++;
+    }
+}
+
+static void
+fail_me(void)
+{
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+increment(unsigned long iterations)
+{
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    const scrBenchmarkOptions bench_options = {.repetitions = 3, .target_time = 0.01};
+    scrOptions options = {.flags = SCR_RF_COUNTERS};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    // The tests should give the same results whether or not the counters are available.
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(loop_briefly);
+    ADD_FAIL(fail_me);
+    scrGroupAddBenchmark(group, "increment", increment, &bench_options);
+    num_pass++;
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
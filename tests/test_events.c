@@ -0,0 +1,107 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+// Enough to fill the pipes between the processes several times over.
+#define NUM_LINES 3000
+
+static void
+print_lines(char c)
+{
+    for (unsigned int k = 0; k < NUM_LINES; k++) {
+        printf("%c-line %04u of some output which is long enough to need a few events\n", c, k);
+    }
+    // Failing doesn't flush stdout.
+    fflush(stdout);
+}
+
+static void
+loud_a(void)
+{
+    print_lines('a');
+    SCR_FAIL("Failing so that the output is shown");
+}
+
+static void
+loud_b(void)
+{
+    print_lines('b');
+    SCR_FAIL("Failing so that the output is shown");
+}
+
+// Both groups' output has to be there in full and neither group's output can be broken up by the other's.
+static bool
+checkOutput(FILE *file)
+{
+    char line[256];
+    unsigned int counts[2] = {0}, num_switches = 0;
+    int last = -1;
+
+    while (fgets(line, sizeof(line), file)) {
+        int which;
+
+        if (strncmp(line + 1, "-line ", 6) != 0 || (line[0] != 'a' && line[0] != 'b')) {
+            continue;
+        }
+        which = line[0] - 'a';
+        if (last >= 0 && which != last) {
+            num_switches++;
+        }
+        last = which;
+        counts[which]++;
+    }
+
+    return counts[0] == NUM_LINES && counts[1] == NUM_LINES && num_switches == 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_fail = 0;
+    int saved_stdout;
+    FILE *file;
+    scrGroup group;
+    scrOptions options = {.max_jobs = 2};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_FAIL(loud_a);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_FAIL(loud_b);
+
+    file = tmpfile();
+    if (!file) {
+        perror("tmpfile");
+        return 1;
+    }
+
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    if (saved_stdout < 0 || dup2(fileno(file), STDOUT_FILENO) < 0) {
+        perror("dup2");
+        return 1;
+    }
+
+    scrRun(&options, &stats);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    rewind(file);
+    ok = stats.num_passed == num_pass && stats.num_failed == num_fail && checkOutput(file);
+    fclose(file);
+
+    printf("Output of the parallel groups %s\n", ok ? "was intact" : "was mixed up or missing");
+    return !ok;
+}
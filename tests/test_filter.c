@@ -0,0 +1,94 @@
+#include <stdio.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void *
+never_create(void *global_ctx)
+{
+    (void)global_ctx;
+    SCR_FAIL("A group without any selected tests was set up");
+}
+
+static void
+parse_numbers(void)
+{
+}
+
+static void
+parse_strings(void)
+{
+    SCR_FAIL("Excluded tests shouldn't run");
+}
+
+static void
+parse_x(void)
+{
+}
+
+static void
+lexer_keywords(void)
+{
+}
+
+static void
+old_lexer(void)
+{
+}
+
+static void
+test_a1(void)
+{
+}
+
+static void
+test_b1(void)
+{
+}
+
+static void
+test_c1(void)
+{
+    SCR_FAIL("Tests outside of the brackets shouldn't run");
+}
+
+static void
+unrelated(void)
+{
+    SCR_FAIL("Unmatched tests shouldn't run");
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    const char *include[] = {"parse_*", "lexer", "test_[ab]?", NULL}, *exclude[] = {"parse_s*", NULL};
+    scrOptions options = {.include_filters = include, .exclude_filters = exclude};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(parse_numbers);
+    scrGroupAddTest(group, "parse_strings", parse_strings, NULL);
+    ADD_PASS(parse_x);
+    ADD_PASS(lexer_keywords);
+    ADD_PASS(old_lexer);
+    scrGroupAddTest(group, "unrelated", unrelated, NULL);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(test_a1);
+    ADD_PASS(test_b1);
+    scrGroupAddTest(group, "test_c1", test_c1, NULL);
+
+    group = scrGroupCreate(never_create, NULL);
+    scrGroupAddTest(group, "unrelated", unrelated, NULL);
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
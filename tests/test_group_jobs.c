@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static int global_fds[2];
+
+static void *
+setup_func(void *global_ctx)
+{
+    (void)global_ctx;
+
+    SCR_ASSERT_EQ(pipe(global_fds), 0);
+
+    return global_fds;
+}
+
+static void
+cleanup_func(void *group_ctx)
+{
+    int *fds = group_ctx;
+
+    SCR_ASSERT_EQ(close(fds[0]), 0);
+    SCR_ASSERT_EQ(close(fds[1]), 0);
+}
+
+static void
+wait_for_writer(void)
+{
+    int *fds = scrGroupCtx();
+    char c;
+
+    SCR_ASSERT_EQ(read(fds[0], &c, 1), 1);
+    SCR_ASSERT_CHAR_EQ(c, 'x');
+}
+
+static void
+writer(void)
+{
+    int *fds = scrGroupCtx();
+
+    SCR_ASSERT_EQ(write(fds[1], "x", 1), 1);
+}
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    SCR_FAIL("Intentionally failing");
+}
+
+static void
+fail_timeout(void)
+{
+    sleep(2);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    const scrTestOptions timeout_options = {.timeout = 1}, reader_options = {.timeout = 5};
+    scrOptions options = {.max_jobs = 1};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    // The reader can only finish if the writer is running at the same time.
+    group = scrGroupCreate(setup_func, cleanup_func);
+    scrGroupSetJobs(group, 3);
+    scrGroupAddTest(group, "wait_for_writer", wait_for_writer, &reader_options);
+    num_pass++;
+    ADD_TIMEOUT(fail_timeout);
+    ADD_PASS(writer);
+    for (int k = 0; k < 5; k++) {
+        ADD_PASS(pass_me);
+        ADD_FAIL(fail_me);
+    }
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
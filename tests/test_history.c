@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static char log_path[] = "/tmp/scrutiny_history_log_XXXXXX";
+
+static void
+short_test(void)
+{
+    logAppend(log_path, "short\n");
+    usleep(10000);
+}
+
+static void
+medium_test(void)
+{
+    logAppend(log_path, "medium\n");
+    usleep(100000);
+}
+
+static void
+long_test(void)
+{
+    logAppend(log_path, "long\n");
+    usleep(200000);
+}
+
+static bool
+startedLast(const char *name)
+{
+    char buffer[256], *last;
+    size_t length;
+
+    if (!readFile(log_path, buffer, sizeof(buffer)) || (length = strlen(buffer)) == 0) {
+        return false;
+    }
+
+    buffer[length - 1] = '\0';
+    last = strrchr(buffer, '\n');
+    return strcmp(last ? last + 1 : buffer, name) == 0;
+}
+
+static bool
+hasLine(const char *path, const char *line)
+{
+    char buffer[1024];
+
+    return readFile(path, buffer, sizeof(buffer)) && strstr(buffer, line) != NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    char history_path[] = "/tmp/scrutiny_history_XXXXXX";
+    scrGroup group;
+    scrOptions options = {.max_jobs = 2, .history_file = history_path};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(history_path) || !createTempFile(log_path)) {
+        return 1;
+    }
+    // The history file must not exist before the first run.
+    unlink(history_path);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(short_test);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(long_test);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(medium_test);
+
+    scrRun(&options, &stats);
+    ok = (stats.num_passed == num_pass && stats.num_skipped == num_skip && stats.num_failed == num_fail &&
+          stats.num_errored == num_error);
+    ok = ok && hasLine(history_path, "t 1 0.2") && hasLine(history_path, "\ng 2 0.1");
+
+    // Now that the durations are known, the shortest group should be started last.
+    ok = ok && truncate(log_path, 0) == 0;
+    scrRun(&options, &stats);
+    ok = ok && stats.num_passed == num_pass && stats.num_skipped == num_skip &&
+         stats.num_failed == num_fail && stats.num_errored == num_error && startedLast("short");
+
+    unlink(history_path);
+    unlink(log_path);
+    return !ok;
+}
@@ -0,0 +1,146 @@
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static int global_value, num_calls;
+
+static void *
+setup_func(void *global_ctx)
+{
+    (void)global_ctx;
+
+    global_value = 5;
+    return &global_value;
+}
+
+static void
+check_ctx(void)
+{
+    SCR_ASSERT_EQ(*(int *)scrGroupCtx(), 5);
+}
+
+static void
+first_call(void)
+{
+    SCR_ASSERT_EQ(num_calls++, 0);
+}
+
+static void
+second_call(void)
+{
+    SCR_ASSERT_EQ(num_calls++, 1);
+}
+
+static void
+forked_after_calls(void)
+{
+    SCR_ASSERT_EQ(num_calls, 2);
+}
+
+static void
+signals_unblocked(void)
+{
+    sigset_t set;
+
+    SCR_ASSERT_EQ(sigprocmask(SIG_BLOCK, NULL, &set), 0);
+    SCR_ASSERT(!sigismember(&set, SIGALRM));
+    SCR_ASSERT(!sigismember(&set, SIGUSR1));
+}
+
+// Stands in for a test that hangs until the run is interrupted.  The runner exits as it would if it had
+// collected the SIGTERM between tests, so the test counts as failed.
+static void
+terminated(void)
+{
+    raise(SIGTERM);
+    sleep(5);
+}
+
+static void
+pass_me(void)
+{
+    printf("This shouldn't be shown\n");
+}
+
+static void
+fail_me(void)
+{
+    printf("This should be shown\n");
+    fprintf(stderr, "So should this\n");
+    SCR_LOG("About to fail");
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+xfail_me(void)
+{
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+static void
+fail_timeout(void)
+{
+    sleep(5);
+}
+
+static void
+increment(unsigned long iterations)
+{
+    static volatile unsigned long counter;
+
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    scrOptions options = {0};
+    const scrTestOptions xfail_options = {.flags = SCR_TF_XFAIL}, timeout_options = {.timeout = 1},
+                         forked_options = {.timeout = 10};
+    const scrBenchmarkOptions bench_options = {.repetitions = 3, .target_time = 0.001};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(setup_func, NULL);
+    scrGroupSetIsolation(group, SCR_ISOLATION_NONE);
+    ADD_PASS(check_ctx);
+    ADD_PASS(first_call);
+    ADD_FAIL(fail_me);
+    ADD_PASS(second_call);
+    ADD_PASS(signals_unblocked);
+    scrGroupAddTest(group, "forked_after_calls", forked_after_calls, &forked_options);
+    num_pass++;
+    ADD_XFAIL(xfail_me);
+    ADD_SKIP(skip_me);
+    ADD_TIMEOUT(fail_timeout);
+    scrGroupAddBenchmark(group, "increment", increment, &bench_options);
+    num_pass++;
+    for (int k = 0; k < 100; k++) {
+        ADD_PASS(pass_me);
+    }
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetIsolation(group, SCR_ISOLATION_NONE);
+    ADD_FAIL(terminated);
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
@@ -0,0 +1,91 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static char log_path[] = "/tmp/scrutiny_journal_log_XXXXXX";
+static bool broken = true;
+
+static void
+steady_a(void)
+{
+    logAppend(log_path, "a");
+}
+
+static void
+flaky_b(void)
+{
+    logAppend(log_path, "b");
+    if (broken) {
+        SCR_FAIL("Still broken");
+    }
+}
+
+static void
+steady_c(void)
+{
+    logAppend(log_path, "c");
+}
+
+static void
+flaky_d(void)
+{
+    logAppend(log_path, "d");
+    if (broken) {
+        SCR_FAIL("Still broken");
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_fail = 0;
+    char journal_path[] = "/tmp/scrutiny_journal_XXXXXX";
+    scrGroup group;
+    scrOptions options = {.max_jobs = 1, .journal_file = journal_path};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(journal_path) || !createTempFile(log_path)) {
+        return 1;
+    }
+    unlink(journal_path);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(steady_a);
+    ADD_FAIL(flaky_b);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(steady_c);
+    ADD_FAIL(flaky_d);
+
+    // Without a journal, the modes have nothing to go on and so everything runs.
+    options.flags = SCR_RF_FAILED_ONLY;
+    scrRun(&options, &stats);
+    ok = counted(&stats, num_pass, num_fail) && logEquals(log_path, "abcd");
+
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 0, 2) && logEquals(log_path, "bd");
+
+    options.flags = SCR_RF_FAILED_GATE;
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 0, 2) && logEquals(log_path, "bd");
+
+    broken = false;
+    options.flags = SCR_RF_FAILED_FIRST;
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 4, 0) && logEquals(log_path, "bdac");
+
+    options.flags = SCR_RF_FAILED_ONLY;
+    scrRun(&options, &stats);
+    ok = ok && counted(&stats, 0, 0) && logEquals(log_path, "");
+
+    unlink(journal_path);
+    unlink(log_path);
+    return !ok;
+}
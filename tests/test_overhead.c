@@ -0,0 +1,41 @@
+#include <stdio.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    printf("Output to send\n");
+    fflush(stdout);
+    SCR_FAIL("Failing so that there's output to send");
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_fail = 0;
+    scrGroup group;
+    scrOptions options = {.max_jobs = 2, .flags = SCR_RF_OVERHEAD};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(pass_me);
+    ADD_FAIL(fail_me);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(pass_me);
+
+    scrRun(&options, &stats);
+
+    // Forking the group runners alone takes some time.
+    return !(stats.num_passed == num_pass && stats.num_failed == num_fail && stats.overhead_time > 0);
+}
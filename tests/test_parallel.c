@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static int fds[2];
+
+static void
+wait_for_writer(void)
+{
+    char c;
+
+    SCR_ASSERT_EQ(read(fds[0], &c, 1), 1);
+    SCR_ASSERT_CHAR_EQ(c, 'x');
+}
+
+static void
+writer(void)
+{
+    SCR_ASSERT_EQ(write(fds[1], "x", 1), 1);
+}
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    SCR_FAIL("Intentionally failing");
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    const scrTestOptions timeout_options = {.timeout = 5};
+    scrOptions options = {.max_jobs = 2};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    // The reader can only finish if its group is running at the same time as the writer's.
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupAddTest(group, "wait_for_writer", wait_for_writer, &timeout_options);
+    num_pass++;
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(writer);
+
+    for (int k = 0; k < 4; k++) {
+        group = scrGroupCreate(NULL, NULL);
+        ADD_PASS(pass_me);
+        ADD_FAIL(fail_me);
+        ADD_SKIP(skip_me);
+    }
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
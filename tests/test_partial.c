@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+// The group runner blocks signals so raise() wouldn't be enough.
+static void
+crash(void)
+{
+    *(volatile int *)NULL = 0;
+}
+
+static void
+crash_cleanup(void *group_ctx)
+{
+    (void)group_ctx;
+    crash();
+}
+
+static void
+fail_cleanup(void *group_ctx)
+{
+    (void)group_ctx;
+    SCR_FAIL("Failing in group cleanup");
+}
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+static void
+crash_runner(void)
+{
+    crash();
+}
+
+static void
+never_reached(void)
+{
+}
+
+// A runner which exits successfully without finishing its tests has lost them rather than skipped them.
+static void *
+exit_create(void *global_ctx)
+{
+    (void)global_ctx;
+    exit(0);
+}
+
+static void
+exit_runner(void)
+{
+    exit(0);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    scrOptions options = {0};
+    scrStats stats;
+    int ret;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    // The tests keep their own results even though the group runner crashes afterwards.
+    group = scrGroupCreate(NULL, crash_cleanup);
+    ADD_PASS(pass_me);
+    ADD_FAIL(fail_me);
+    ADD_SKIP(skip_me);
+
+    group = scrGroupCreate(NULL, fail_cleanup);
+    ADD_PASS(pass_me);
+
+    // Only the test which takes down the runner and the ones after it are errors.
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetIsolation(group, SCR_ISOLATION_NONE);
+    ADD_PASS(pass_me);
+    ADD_ERROR(crash_runner);
+    ADD_ERROR(never_reached);
+
+    group = scrGroupCreate(exit_create, NULL);
+    ADD_ERROR(pass_me);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetIsolation(group, SCR_ISOLATION_NONE);
+    ADD_PASS(pass_me);
+    ADD_ERROR(exit_runner);
+    ADD_ERROR(never_reached);
+
+    ret = scrRun(&options, &stats);
+
+    return (ret == 0 || stats.num_passed != num_pass || stats.num_skipped != num_skip ||
+            stats.num_failed != num_fail || stats.num_errored != num_error || stats.num_group_errors != 2);
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#ifdef SCR_MONKEYPATCH
+
+static void *
+group_setup(void *global_ctx)
+{
+    // The group runner only patches itself after create_fn.
+    SCR_ASSERT_NEQ(getppid(), 0);
+    return global_ctx;
+}
+
+static void
+group_cleanup(void *group_ctx)
+{
+    (void)group_ctx;
+    SCR_ASSERT_NEQ(getppid(), 0);
+}
+
+static pid_t
+fake_getppid(void)
+{
+    return 0;
+}
+
+// A second patch of the same function wins over the first one.
+static pid_t
+other_fake_getppid(void)
+{
+    return -1;
+}
+
+static void
+test_fake_getppid(void)
+{
+    SCR_ASSERT_EQ(getppid(), 0);
+}
+
+static void
+test_true_getppid(void)
+{
+    pid_t (*true_getppid)(void);
+
+    true_getppid = scrPatchedFunction("getppid");
+    SCR_ASSERT_PTR_NEQ(true_getppid, NULL);
+    SCR_ASSERT_NEQ(true_getppid(), 0);
+}
+
+static void
+test_patched_twice(void)
+{
+    SCR_ASSERT_EQ(getppid(), -1);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0;
+    const scrIsolation isolations[] = {SCR_ISOLATION_TEST, SCR_ISOLATION_BATCH, SCR_ISOLATION_NONE};
+    scrGroup group;
+    scrOptions options = {.flags = SCR_RF_PATCH_ONCE};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    for (unsigned int k = 0; k < sizeof(isolations) / sizeof(isolations[0]); k++) {
+        group = scrGroupCreate(group_setup, group_cleanup);
+        scrGroupSetIsolation(group, isolations[k]);
+        if (!scrGroupPatchFunction(group, "getppid", NULL, fake_getppid)) {
+            return 1;
+        }
+        ADD_PASS(test_fake_getppid);
+        ADD_PASS(test_true_getppid);
+    }
+
+    // group_cleanup checks that both patches were undone.
+    group = scrGroupCreate(group_setup, group_cleanup);
+    if (!scrGroupPatchFunction(group, "getppid", NULL, fake_getppid) ||
+        !scrGroupPatchFunction(group, "getppid", NULL, other_fake_getppid)) {
+        return 1;
+    }
+    ADD_PASS(test_patched_twice);
+    ADD_PASS(test_true_getppid);
+
+    scrRun(&options, &stats);
+
+    return !(stats.num_passed == num_pass && stats.num_group_errors == 0);
+}
+
+#else  // SCR_MONKEYPATCH
+
+int
+main()
+{
+    return 0;
+}
+
+#endif
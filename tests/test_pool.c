@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static int global_value;
+
+static void *
+setup_func(void *global_ctx)
+{
+    (void)global_ctx;
+
+    global_value = 5;
+    return &global_value;
+}
+
+static void
+check_ctx(void)
+{
+    SCR_ASSERT_EQ(*(int *)scrGroupCtx(), 5);
+    printf("Some output\n");
+}
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    fprintf(stderr, "Failing on purpose\n");
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+static void
+fail_timeout(void)
+{
+    sleep(5);
+}
+
+static void
+increment(unsigned long iterations)
+{
+    static volatile unsigned long counter;
+
+    for (unsigned long k = 0; k < iterations; k++) {
+        counter++;
+    }
+}
+
+static void
+addTests(unsigned int *num_pass, unsigned int *num_skip, unsigned int *num_fail)
+{
+    scrGroup group;
+    const scrTestOptions timeout_options = {.timeout = 1};
+    const scrBenchmarkOptions bench_options = {.repetitions = 3, .target_time = 0.001};
+
+    group = scrGroupCreate(setup_func, NULL);
+    scrGroupSetJobs(group, 2);
+    scrGroupAddTest(group, "fail_timeout", fail_timeout, &timeout_options);
+    (*num_fail)++;
+    scrGroupAddBenchmark(group, "increment", increment, &bench_options);
+    (*num_pass)++;
+    for (int k = 0; k < 20; k++) {
+        scrGroupAddTest(group, "check_ctx", check_ctx, NULL);
+        scrGroupAddTest(group, "pass_me", pass_me, NULL);
+        scrGroupAddTest(group, "fail_me", fail_me, NULL);
+        scrGroupAddTest(group, "skip_me", skip_me, NULL);
+        *num_pass += 2;
+        (*num_fail)++;
+        (*num_skip)++;
+    }
+
+    // A group with fewer tests than idle workers.
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupAddTest(group, "pass_me", pass_me, NULL);
+    (*num_pass)++;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrOptions options = {.pool_size = 3, .max_jobs = 1};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    addTests(&num_pass, &num_skip, &num_fail);
+
+    scrRun(&options, &stats);
+    ok = (stats.num_passed == num_pass && stats.num_skipped == num_skip && stats.num_failed == num_fail &&
+          stats.num_errored == num_error);
+
+    options.flags = SCR_RF_STREAM;
+    scrRun(&options, &stats);
+    ok = ok && (stats.num_passed == num_pass && stats.num_skipped == num_skip && stats.num_failed == num_fail &&
+                stats.num_errored == num_error);
+
+    // The group is stopped while it still has idle workers, which are retired without having run anything.
+    options.flags = SCR_RF_FAIL_FAST;
+    scrRun(&options, &stats);
+    ok = ok && stats.num_failed > 0 && stats.num_failed < num_fail && stats.num_errored == 0;
+
+    return !ok;
+}
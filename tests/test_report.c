@@ -0,0 +1,129 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void
+pass_me(void)
+{
+}
+
+static void
+fail_me(void)
+{
+    printf("Needs <escaping> & \"quoting\"\n");
+    fflush(stdout);
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+skip_me(void)
+{
+    SCR_TEST_SKIP();
+}
+
+static void
+time_out(void)
+{
+    while (1) {
+        pause();
+    }
+}
+
+// The test's process exits with exit rather than _exit so it flushes whatever it inherited from the runner.
+static void
+exit_early(void)
+{
+    exit(0);
+}
+
+static unsigned int
+countLines(const char *contents)
+{
+    unsigned int num_lines = 0;
+
+    for (; *contents; contents++) {
+        num_lines += (*contents == '\n');
+    }
+    return num_lines;
+}
+
+static bool
+checkJunit(const char *path)
+{
+    char contents[8192];
+
+    if (!readFile(path, contents, sizeof(contents))) {
+        return false;
+    }
+
+    // A second copy of the prologue would mean that a child process wrote it out again.
+    return strstr(contents, "<?xml") == contents && !strstr(contents + 1, "<?xml") &&
+           strstr(contents, "tests=\"0000000005\" failures=\"0000000002\" errors=\"0000000000\" "
+                            "skipped=\"0000000001\"") &&
+           strstr(contents, "<testcase classname=\"group1\" name=\"time_out\"") &&
+           strstr(contents, "<failure message=\"Timed out\">") &&
+           strstr(contents, "<system-out>Needs &lt;escaping&gt; &amp; &quot;quoting&quot;\n</system-out>") &&
+           strstr(contents, "</testsuites>\n");
+}
+
+static bool
+checkJsonLines(const char *path)
+{
+    char contents[8192];
+
+    if (!readFile(path, contents, sizeof(contents))) {
+        return false;
+    }
+
+    return countLines(contents) == 6 &&
+           strstr(contents, "\"name\":\"skip_me\",\"status\":\"skipped\"") &&
+           strstr(contents, "\"reason\":\"Timed out\"") &&
+           strstr(contents, "\"stdout\":\"Needs <escaping> & \\\"quoting\\\"\\n\"") &&
+           strstr(contents, "{\"type\":\"summary\",\"passed\":2,\"skipped\":1,\"failed\":2,\"errored\":0,");
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0;
+    char junit_path[] = "/tmp/scrutiny_junit_XXXXXX", jsonl_path[] = "/tmp/scrutiny_jsonl_XXXXXX";
+    scrGroup group;
+    const scrTestOptions timeout_options = {.timeout = 1};
+    scrOptions options = {.max_jobs = 1, .junit_file = junit_path, .jsonl_file = jsonl_path};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(junit_path)) {
+        return 1;
+    }
+    if (!createTempFile(jsonl_path)) {
+        unlink(junit_path);
+        return 1;
+    }
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(pass_me);
+    ADD_FAIL(fail_me);
+    ADD_SKIP(skip_me);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_TIMEOUT(time_out);
+    ADD_PASS(exit_early);
+
+    scrRun(&options, &stats);
+
+    ok = stats.num_passed == num_pass && stats.num_skipped == num_skip && stats.num_failed == num_fail &&
+         checkJunit(junit_path) && checkJsonLines(jsonl_path);
+
+    unlink(junit_path);
+    unlink(jsonl_path);
+    return !ok;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#define NUM_TESTS   12
+#define NUM_SHARDS  3
+#define DEFINE_TEST(n)             \
+    static void test_##n(void)     \
+    {                              \
+        logRun(n);                 \
+    }
+
+static char log_path[] = "/tmp/scrutiny_shard_log_XXXXXX";
+
+static void
+logRun(int n)
+{
+    const char text[] = {'a' + n, '\0'};
+
+    logAppend(log_path, text);
+}
+
+DEFINE_TEST(0)
+DEFINE_TEST(1)
+DEFINE_TEST(2)
+DEFINE_TEST(3)
+DEFINE_TEST(4)
+DEFINE_TEST(5)
+DEFINE_TEST(6)
+DEFINE_TEST(7)
+DEFINE_TEST(8)
+DEFINE_TEST(9)
+DEFINE_TEST(10)
+DEFINE_TEST(11)
+
+// Checks that every test ran exactly once across the shards.
+static bool
+coveredOnce(void)
+{
+    char buffer[NUM_TESTS * 2];
+    unsigned int counts[NUM_TESTS] = {0};
+
+    if (!readFile(log_path, buffer, sizeof(buffer)) || strlen(buffer) != NUM_TESTS) {
+        return false;
+    }
+
+    for (int k = 0; k < NUM_TESTS; k++) {
+        counts[buffer[k] - 'a']++;
+    }
+    for (int k = 0; k < NUM_TESTS; k++) {
+        if (counts[k] != 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+runShards(scrOptions *options, unsigned int num_pass)
+{
+    unsigned int total = 0;
+    char history[4096];
+    scrStats stats;
+
+    // Every shard has to start from the same history, just as they would when running side by side.
+    if (options->history_file && !readFile(options->history_file, history, sizeof(history))) {
+        return false;
+    }
+
+    if (truncate(log_path, 0) != 0) {
+        return false;
+    }
+    options->shard_count = NUM_SHARDS;
+    for (unsigned int k = 0; k < NUM_SHARDS; k++) {
+        if (options->history_file && !writeFile(options->history_file, history)) {
+            return false;
+        }
+        options->shard_index = k;
+        if (scrRun(options, &stats) != 0) {
+            return false;
+        }
+        total += stats.num_passed;
+    }
+
+    return total == num_pass && coveredOnce();
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0;
+    char history_path[] = "/tmp/scrutiny_shard_history_XXXXXX";
+    scrGroup group;
+    scrOptions options = {0};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(log_path) || !createTempFile(history_path)) {
+        return 1;
+    }
+    unlink(history_path);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(test_0);
+    ADD_PASS(test_1);
+    ADD_PASS(test_2);
+    ADD_PASS(test_3);
+    ADD_PASS(test_4);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(test_5);
+    ADD_PASS(test_6);
+    ADD_PASS(test_7);
+    ADD_PASS(test_8);
+    ADD_PASS(test_9);
+    ADD_PASS(test_10);
+    ADD_PASS(test_11);
+
+    // Without any history, the tests are split by their names.
+    ok = runShards(&options, num_pass);
+
+    // A full run records the durations and the following shards are balanced by them.
+    options.history_file = history_path;
+    options.shard_count = 0;
+    ok = ok && truncate(log_path, 0) == 0;
+    ok = ok && scrRun(&options, &stats) == 0 && stats.num_passed == num_pass && coveredOnce();
+    ok = ok && runShards(&options, num_pass);
+
+    // The environment is only consulted when the options don't set a shard count.
+    options.history_file = NULL;
+    options.shard_count = 0;
+    setenv("SCRUTINY_SHARD_INDEX", "0", 1);
+    setenv("SCRUTINY_SHARD_COUNT", "1000", 1);
+    ok = ok && scrRun(&options, &stats) == 0 && stats.num_passed < num_pass;
+    setenv("SCRUTINY_SHARD_INDEX", "1000", 1);
+    ok = ok && scrRun(&options, &stats) != 0 && stats.num_passed == 0;
+    unsetenv("SCRUTINY_SHARD_INDEX");
+    unsetenv("SCRUTINY_SHARD_COUNT");
+
+    unlink(history_path);
+    unlink(log_path);
+    return !ok;
+}
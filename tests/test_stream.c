@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void
+stdout_lines(void)
+{
+    for (int k = 0; k < 3; k++) {
+        printf("Line %i of stdout\n", k);
+        usleep(10000);
+    }
+}
+
+static void
+stderr_lines(void)
+{
+    for (int k = 0; k < 3; k++) {
+        fprintf(stderr, "Line %i of stderr\n", k);
+        usleep(10000);
+    }
+}
+
+static void
+partial_line(void)
+{
+    printf("This line has no newline");
+}
+
+static void
+long_line(void)
+{
+    char buffer[1000];
+
+    memset(buffer, 'x', sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+    printf("%s\n", buffer);
+}
+
+static void
+log_and_fail(void)
+{
+    SCR_LOG("About to fail");
+    SCR_FAIL("Failing on purpose");
+}
+
+static void
+raw_write(void)
+{
+    const char message[] = "Written without stdio\n";
+
+    SCR_ASSERT_EQ(write(STDOUT_FILENO, message, sizeof(message) - 1), sizeof(message) - 1);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    scrOptions options = {.flags = SCR_RF_STREAM, .max_jobs = 2};
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    scrGroupSetJobs(group, 2);
+    ADD_PASS(stdout_lines);
+    ADD_PASS(stderr_lines);
+    ADD_PASS(partial_line);
+    ADD_PASS(long_line);
+    ADD_FAIL(log_and_fail);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(raw_write);
+    ADD_PASS(stdout_lines);
+
+    scrRun(&options, &stats);
+
+    return (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+            stats.num_errored != num_error);
+}
@@ -0,0 +1,132 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+static void *
+create(void *global_ctx)
+{
+    return global_ctx;
+}
+
+static void
+cleanup(void *group_ctx)
+{
+    (void)group_ctx;
+}
+
+static void
+first_test(void)
+{
+}
+
+static void
+second_test(void)
+{
+    usleep(1000);
+}
+
+static void
+third_test(void)
+{
+    SCR_FAIL("Failing so that there's output to send");
+}
+
+// The test's process exits with exit rather than _exit so it flushes whatever it inherited from the runner.
+static void
+exiting_test(void)
+{
+    exit(0);
+}
+
+// Apart from the brackets, every line holds one event.  Anything written twice by a child process would show
+// up as a second bracket or as a line that's cut short.
+static bool
+eventsWellFormed(char *contents)
+{
+    char *line, *save_ptr;
+    size_t length;
+    bool last = false;
+
+    line = strtok_r(contents, "\n", &save_ptr);
+    if (!line || strcmp(line, "[") != 0) {
+        return false;
+    }
+
+    while ((line = strtok_r(NULL, "\n", &save_ptr))) {
+        if (last) {
+            return false;
+        }
+        if (strcmp(line, "]") == 0) {
+            last = true;
+            continue;
+        }
+
+        length = strlen(line);
+        if (line[0] != '{' || (strcmp(line + length - 1, "}") != 0 && strcmp(line + length - 2, "},") != 0)) {
+            return false;
+        }
+    }
+
+    return last;
+}
+
+static bool
+checkTrace(const char *path)
+{
+    char contents[16384];
+    size_t length;
+
+    if (!readFile(path, contents, sizeof(contents))) {
+        return false;
+    }
+    length = strlen(contents);
+
+    return length >= 3 && strncmp(contents, "[\n", 2) == 0 && strcmp(contents + length - 3, "\n]\n") == 0 &&
+           strstr(contents, "\"args\":{\"name\":\"group 1\"}") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"group 0\",\"cat\":\"group\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"create_fn\",\"cat\":\"overhead\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"cleanup_fn\",\"cat\":\"overhead\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"fork\",\"cat\":\"overhead\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"send output\",\"cat\":\"overhead\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"second_test\",\"cat\":\"test\"") &&
+           strstr(contents, "{\"ph\":\"X\",\"name\":\"third_test\",\"cat\":\"test\"") &&
+           eventsWellFormed(contents);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_fail = 0;
+    char trace_path[] = "/tmp/scrutiny_trace_XXXXXX";
+    scrGroup group;
+    scrOptions options = {.max_jobs = 2, .trace_file = trace_path};
+    scrStats stats;
+    bool ok;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    if (!createTempFile(trace_path)) {
+        return 1;
+    }
+
+    group = scrGroupCreate(create, cleanup);
+    ADD_PASS(first_test);
+    ADD_PASS(second_test);
+    group = scrGroupCreate(NULL, NULL);
+    ADD_FAIL(third_test);
+    ADD_PASS(exiting_test);
+
+    scrRun(&options, &stats);
+
+    ok = stats.num_passed == num_pass && stats.num_failed == num_fail && checkTrace(trace_path);
+
+    unlink(trace_path);
+    return !ok;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <scrutiny/scrutiny.h>
+
+#include "common.h"
+
+#define BIG_ALLOCATION (64 * 1024 * 1024)
+
+static void
+sleep_briefly(void)
+{
+    usleep(100000);
+}
+
+static void
+spin_briefly(void)
+{
+    clock_t start = clock();
+
+    while (clock() - start < CLOCKS_PER_SEC / 10) {}
+}
+
+static void
+allocate_memory(void)
+{
+    // Writing through a volatile pointer keeps the compiler from eliding the allocation.
+    volatile char *buffer = malloc(BIG_ALLOCATION);
+
+    if (!buffer) {
+        SCR_FAIL("malloc failed");
+    }
+    for (size_t k = 0; k < BIG_ALLOCATION; k += 1024) {
+        buffer[k] = 'x';
+    }
+    free((void *)buffer);
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned int num_pass = 0, num_skip = 0, num_fail = 0, num_error = 0;
+    scrGroup group;
+    scrStats stats;
+    (void)argc;
+
+    printf("\nRunning %s\n\n", argv[0]);
+
+    group = scrGroupCreate(NULL, NULL);
+    ADD_PASS(sleep_briefly);
+    ADD_PASS(spin_briefly);
+    ADD_PASS(allocate_memory);
+
+    scrRun(NULL, &stats);
+
+    if (stats.num_passed != num_pass || stats.num_skipped != num_skip || stats.num_failed != num_fail ||
+        stats.num_errored != num_error) {
+        return 1;
+    }
+
+    return (stats.max_usage.wall_time < 0.1 || stats.total_usage.wall_time < 0.2 ||
+            stats.total_usage.user_time + stats.total_usage.system_time < 0.05 || stats.max_usage.max_rss < BIG_ALLOCATION / 1024);
+}